@@ -0,0 +1,109 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Arena.h
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace cxxcam
+{
+
+/*
+ * Monotonic allocation arena.
+ * Memory is carved sequentially from large blocks and is only released by
+ * reset(), which keeps the blocks for reuse. A workload repeated between
+ * resets performs no heap allocation once the arena has grown to its peak.
+ * Nothing allocated from the arena may be used after reset().
+ */
+class arena
+{
+private:
+	struct block
+	{
+		std::unique_ptr<char[]> data;
+		std::size_t size;
+	};
+	
+	std::vector<block> m_Blocks;
+	std::size_t m_Block;
+	std::size_t m_Offset;
+	std::size_t m_BlockSize;
+public:
+	explicit arena(std::size_t block_size = 1 << 20);
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+	
+	void* allocate(std::size_t size, std::size_t alignment);
+	void reset();
+	
+	// Total size of the blocks held.
+	std::size_t capacity() const;
+};
+
+/*
+ * Standard allocator over an arena. Deallocation is a no-op.
+ */
+template <typename T>
+class arena_allocator
+{
+private:
+	template <typename U>
+	friend class arena_allocator;
+	
+	arena* m_Arena;
+public:
+	typedef T value_type;
+	
+	explicit arena_allocator(arena& a)
+	 : m_Arena(&a)
+	{
+	}
+	template <typename U>
+	arena_allocator(const arena_allocator<U>& o)
+	 : m_Arena(o.m_Arena)
+	{
+	}
+	
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(m_Arena->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, std::size_t)
+	{
+	}
+	
+	template <typename U>
+	bool operator==(const arena_allocator<U>& o) const
+	{
+		return m_Arena == o.m_Arena;
+	}
+	template <typename U>
+	bool operator!=(const arena_allocator<U>& o) const
+	{
+		return m_Arena != o.m_Arena;
+	}
+};
+
+}
+
+#endif /* ARENA_H_ */
@@ -27,6 +27,7 @@
 #include "Math.h"
 #include <iosfwd>
 #include <vector>
+#include <cstddef>
 
 namespace cxxcam
 {
@@ -50,7 +51,19 @@ struct Bbox
 	Bbox& operator+=(const math::point_3& p);
 };
 
-Bbox construct(const std::vector<math::point_3>& points);
+/*
+ * Extent of a set of points.
+ * Sets larger than a block are reduced on up to `threads` threads
+ * (0 uses the hardware concurrency); the result is independent of the
+ * thread count.
+ */
+Bbox construct(const std::vector<math::point_3>& points, unsigned threads = 1);
+
+/*
+ * As above over coordinate arrays (e.g. path::path_soa) holding n values in
+ * metres, reduced with vector min / max.
+ */
+Bbox construct(const double* x, const double* y, const double* z, std::size_t n, unsigned threads = 1);
 
 std::ostream& operator<<(std::ostream& os, const Bbox&);
 
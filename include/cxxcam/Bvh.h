@@ -0,0 +1,94 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bvh.h
+ */
+
+#ifndef BVH_H_
+#define BVH_H_
+#include "Path.h"
+#include "Bbox.h"
+#include <vector>
+#include <cstddef>
+
+namespace cxxcam
+{
+namespace path
+{
+
+/*
+ * Bounding volume hierarchy over the segments between consecutive points of
+ * a toolpath. Segment i joins point i and point i + 1.
+ * Leaves hold runs of consecutive segments, which are spatially coherent on
+ * a toolpath, and are paired in path order. Appending points refits one
+ * node per level so moves can be added as they are expanded.
+ */
+class segment_bvh
+{
+public:
+	static const std::size_t npos = static_cast<std::size_t>(-1);
+	
+	segment_bvh();
+	explicit segment_bvh(const std::vector<step>& path);
+	
+	void append(const math::point_3& p);
+	void append(const std::vector<step>& path);
+	void append(const path_soa& path);
+	void clear();
+	
+	// Number of segments.
+	std::size_t size() const;
+	bool empty() const;
+	
+	math::point_3 start(std::size_t segment) const;
+	math::point_3 end(std::size_t segment) const;
+	Bbox bounds() const;
+	
+	// Segments that come within d of the point or box, in path order.
+	std::vector<std::size_t> within(const math::point_3& p, units::length d) const;
+	std::vector<std::size_t> within(const Bbox& box, units::length d) const;
+	
+	// First segment in path order that touches the region, or npos.
+	std::size_t first_entering(const Bbox& region) const;
+	
+private:
+	struct box
+	{
+		double min[3];
+		double max[3];
+		
+		box& operator+=(const box& b);
+	};
+	
+	template <typename Test, typename Visit>
+	bool traverse(std::size_t level, std::size_t node, const Test& test, const Visit& visit) const;
+	void append(double x, double y, double z);
+	box segment_box(std::size_t segment) const;
+	
+	std::vector<double> m_X;
+	std::vector<double> m_Y;
+	std::vector<double> m_Z;
+	
+	// m_Levels[0] are the leaves; each node of level k bounds nodes 2i and 2i + 1 of level k - 1.
+	std::vector<std::vector<box>> m_Levels;
+};
+
+}
+}
+
+#endif /* BVH_H_ */
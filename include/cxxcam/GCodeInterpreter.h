@@ -0,0 +1,137 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * GCodeInterpreter.h
+ */
+
+#ifndef GCODEINTERPRETER_H_
+#define GCODEINTERPRETER_H_
+#include <vector>
+#include <cstddef>
+#include "GCodeLine.h"
+#include "GCodeParser.h"
+#include "Path.h"
+#include "Units.h"
+
+namespace cxxcam
+{
+namespace gcode
+{
+
+struct motion_t;
+
+/*
+ * Interprets the lines of a G-code program as moves.
+ *
+ * Tracks the modal state: motion mode (G0 - G3, G80), plane (G17 - G19),
+ * distance mode for positions (G90 / G91) and arc centers (G90.1 / G91.1),
+ * units (G20 / G21), feed rate (F), and spindle speed (S) and direction
+ * (M3 / M4 / M5).
+ * Each line with axis words makes a path::move_t for path::move_steps or
+ * path::expand_program. Linear moves of only the rotary axes are Rotary.
+ * Arcs take their center from IJK or R; centers within 0.002mm (or 0.1%)
+ * of equidistant from the start and end are moved onto the bisector as
+ * path::expand_arc requires. On an arc move P gives the number of turns,
+ * a positive integer, unless G4 or G64 on the line takes it.
+ * G2 / G3 follow RS274: counter clockwise is viewed from +Z (G17), +Y (G18)
+ * or +X (G19). path::move_t::dir is the direction in the coordinate pairs
+ * of path::arc_plan, so it is reversed from the G code in G18 and G19.
+ *
+ * Codes that alter the coordinate system, offset the tool or move in ways
+ * not modelled (G5.x, G10, G28, G30, G33.x, G38.x, G41 - G43.x, G52, G53,
+ * G54 - G59.x, G73, G76, canned cycles, G92, G92.3, G93, G95) throw
+ * cxxcam::error. As no offset can be active, the cancels G40, G49, G92.1
+ * and G92.2 have no effect; other codes are ignored.
+ */
+class Interpreter
+{
+public:
+	enum class Motion
+	{
+		None,
+		Rapid,
+		Linear,
+		ClockwiseArc,
+		CounterClockwiseArc
+	};
+	enum class Plane
+	{
+		XY,
+		ZX,
+		YZ
+	};
+	enum class SpindleDirection
+	{
+		Stop,
+		Clockwise,
+		CounterClockwise
+	};
+private:
+	modal_t m_Modal;
+	Motion m_Motion;
+	Plane m_Plane;
+	bool m_AbsoluteArcs;
+	unsigned long m_Speed;
+	SpindleDirection m_Spindle;
+	
+	// Lines applied; the source line of Line input.
+	std::size_t m_Lines;
+	std::vector<program_t::word_t> m_Words;
+	
+	bool Apply(const program_t::word_t* first, const program_t::word_t* last, std::size_t number, motion_t& motion);
+public:
+	
+	Interpreter();
+	explicit Interpreter(const modal_t& modal);
+	
+	/*
+	 * Applies the next line; returns true and sets motion if it moves.
+	 */
+	bool Apply(const Line& line, motion_t& motion);
+	bool Apply(const program_t& program, std::size_t i, motion_t& motion);
+	
+	// Moves of the remaining lines.
+	std::vector<motion_t> Run(const std::vector<Line>& lines);
+	std::vector<motion_t> Run(const program_t& program);
+	
+	const modal_t& Modal() const;
+	Motion MotionMode() const;
+	Plane ActivePlane() const;
+	unsigned long SpindleSpeed() const;
+	SpindleDirection Spindle() const;
+};
+
+/*
+ * Move of a program with the state it was made under.
+ * line is the index of the line that made it.
+ */
+struct motion_t
+{
+	path::move_t move;
+	bool rapid;
+	units::velocity feed;
+	unsigned long speed;
+	Interpreter::SpindleDirection spindle;
+	std::size_t line;
+};
+
+}
+}
+
+#endif /* GCODEINTERPRETER_H_ */
@@ -26,6 +26,7 @@
 #define GCODELINE_H_
 #include <vector>
 #include <string>
+#include <cstddef>
 #include "GCodeWord.h"
 
 namespace cxxcam
@@ -51,13 +52,21 @@ public:
 	bool empty() const;
 
 	void Comment(const std::string& comment);
-	std::string Comment() const;
+	const std::string& Comment() const;
 
 	Line& operator+=(const Word& word);
 
 	std::string debug_str() const;
 };
 
+/*
+ * Writes the line as debug_str does (including the newline) into buffer,
+ * without a terminator and without allocating.
+ * Returns the length of the formatted line; if it is longer than size the
+ * contents of buffer are unspecified.
+ */
+std::size_t format(char* buffer, std::size_t size, const Line& line);
+
 }
 }
 
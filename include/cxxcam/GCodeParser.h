@@ -0,0 +1,129 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * GCodeParser.h
+ */
+
+#ifndef GCODEPARSER_H_
+#define GCODEPARSER_H_
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "GCodeLine.h"
+#include "Position.h"
+#include "Units.h"
+
+namespace cxxcam
+{
+namespace gcode
+{
+
+/*
+ * Compact parsed form of a program.
+ * The words of all lines are held in one array with each line a range of
+ * it, so a program of millions of lines is a handful of allocations.
+ * Blank lines are not stored; number is the line in the source (from 1).
+ */
+struct program_t
+{
+	static const std::uint32_t no_comment = 0xFFFFFFFF;
+	
+	struct word_t
+	{
+		Word::Code code;
+		// Index into comments or no_comment.
+		std::uint32_t comment;
+		double value;
+	};
+	
+	struct line_t
+	{
+		std::size_t first;
+		std::size_t count;
+		std::size_t number;
+		std::uint32_t comment;
+	};
+	
+	std::vector<word_t> words;
+	std::vector<line_t> lines;
+	std::vector<std::string> comments;
+	
+	std::size_t size() const;
+	bool empty() const;
+	void clear();
+	
+	// Builds the gcode::Line for line i.
+	Line line(std::size_t i) const;
+};
+
+/*
+ * Parses G-code text.
+ * Words are a letter (either case) and a decimal number, optionally
+ * separated by spaces. A parenthesised comment following a word is the
+ * comment of that word, otherwise of the line, as are ';' comments.
+ * This is the form written by operator<< and Writer.
+ * Line numbers (N), block delete ('/') and program delimiters ('%') are
+ * skipped. Numbers are parsed without the C library or locale and are
+ * exact for up to 15 significant digits.
+ * Throws cxxcam::error with the source line for anything else (e.g.
+ * parameters and expressions).
+ *
+ * Text of more than a few MB is split into chunks at line boundaries which
+ * are parsed on up to `threads` threads (0 uses the hardware concurrency);
+ * the result is independent of the thread count.
+ */
+program_t parse(const char* data, std::size_t size, unsigned threads = 1);
+program_t parse(const std::string& text, unsigned threads = 1);
+
+// Memory maps and parses the file.
+program_t parse_file(const std::string& filename, unsigned threads = 1);
+
+/*
+ * Modal state carried between lines that positions depend on; the
+ * distance mode (G90 / G91), units (G20 / G21) and feed rate.
+ * Modes set on a line apply to that line. Inch values are converted;
+ * rotary axes are in degrees in either units.
+ */
+struct modal_t
+{
+	bool absolute;
+	bool metric;
+	units::velocity feed;
+	Position position;
+	
+	// Absolute, metric, at the origin.
+	modal_t();
+	
+	// Applies the words of line i of the program.
+	void apply(const program_t& program, std::size_t i);
+	void apply(const program_t::word_t* first, const program_t::word_t* last);
+};
+
+/*
+ * Absolute position at the end of each line of a parsed program.
+ * Words are line local so parsing runs in parallel; the modal state is
+ * then resolved in this single sequential pass.
+ */
+std::vector<Position> resolve(const program_t& program, modal_t state = {});
+
+}
+}
+
+#endif /* GCODEPARSER_H_ */
@@ -26,6 +26,7 @@
 #define GCODEWORD_H_
 #include <string>
 #include <iosfwd>
+#include <cstddef>
 
 namespace cxxcam
 {
@@ -73,12 +74,21 @@ public:
 	double Value() const;
 
 	void Comment(const std::string& comment);
-	std::string Comment() const;
+	const std::string& Comment() const;
 };
 
+char to_char(Word::Code code);
 std::string to_string(Word::Code code);
 std::ostream& operator<<(std::ostream& os, const Word& word);
 
+/*
+ * Writes the word exactly as operator<< does into buffer, without a
+ * terminator and without allocating.
+ * Returns the length of the formatted word; nothing is written if it
+ * is longer than size.
+ */
+std::size_t format(char* buffer, std::size_t size, const Word& word);
+
 }
 }
 
@@ -0,0 +1,80 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * GCodeWriter.h
+ */
+
+#ifndef GCODEWRITER_H_
+#define GCODEWRITER_H_
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+#include "GCodeLine.h"
+
+namespace cxxcam
+{
+namespace gcode
+{
+
+/*
+ * Writes lines of a program through a large reusable buffer.
+ * Lines are formatted directly into the buffer, which is written to the
+ * file descriptor or stream only when full or on Flush.
+ * Errors writing throw cxxcam::error; the destructor flushes but cannot
+ * report errors, so call Flush to observe them.
+ */
+class Writer
+{
+private:
+	std::vector<char> m_Buffer;
+	std::size_t m_Used;
+	
+	int m_Fd;
+	std::ostream* m_Stream;
+	
+	std::uint64_t m_Bytes;
+	std::uint64_t m_Lines;
+	
+	void Write(const char* data, std::size_t size);
+public:
+	static const std::size_t default_buffer = 1 << 20;
+	
+	// The descriptor is not closed.
+	explicit Writer(int fd, std::size_t buffer_size = default_buffer);
+	explicit Writer(std::ostream& os, std::size_t buffer_size = default_buffer);
+	~Writer();
+	
+	Writer(const Writer&) = delete;
+	Writer& operator=(const Writer&) = delete;
+	
+	void Write(const Line& line);
+	Writer& operator<<(const Line& line);
+	
+	void Flush();
+	
+	// Totals of the lines written, including those still buffered.
+	std::uint64_t Bytes() const;
+	std::uint64_t Lines() const;
+};
+
+}
+}
+
+#endif /* GCODEWRITER_H_ */
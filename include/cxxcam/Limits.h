@@ -26,17 +26,67 @@
 #define LIMITS_H_
 #include "Axis.h"
 #include "Units.h"
-#include <map>
+#include <array>
 #include <vector>
+#include <limits>
+#include <cmath>
+#include <cstddef>
 
 namespace cxxcam
 {
 
 struct Position;
 
+namespace path
+{
+struct path_t;
+struct path_soa;
+}
+
 namespace limits
 {
 
+/*
+ * Per axis values indexed by Axis::Type.
+ * Unset axes hold NaN so a lookup is a single array access.
+ */
+template <typename T>
+class axis_table
+{
+private:
+	std::array<T, 9> m_Values;
+public:
+	axis_table()
+	{
+		m_Values.fill(T::from_value(std::numeric_limits<double>::quiet_NaN()));
+	}
+	
+	void set(Axis::Type axis, T value)
+	{
+		m_Values[static_cast<std::size_t>(axis)] = value;
+	}
+	bool has(Axis::Type axis) const
+	{
+		return !std::isnan(m_Values[static_cast<std::size_t>(axis)].value());
+	}
+	// Unset axes return NaN
+	T get(Axis::Type axis) const
+	{
+		return m_Values[static_cast<std::size_t>(axis)];
+	}
+};
+
+/*
+ * Step of an expanded path whose position is beyond the travel limit
+ * of a (linear) axis.
+ */
+struct travel_violation
+{
+	std::size_t step;
+	Axis::Type axis;
+	units::length travel;
+};
+
 /*
  * Though useless for absolute machine travel limits
  * this class will be maintained for work envelope tracking
@@ -46,7 +96,7 @@ namespace limits
 class Travel
 {
 private:
-	std::map<Axis::Type, units::length> m_Limits;
+	axis_table<units::length> m_Limits;
 public:
 	
 	void SetLimit(Axis::Type axis, units::length limit);
@@ -54,6 +104,18 @@ public:
 	// Throws cxxcam::error if out of limits
 	void Validate(Axis::Type axis, units::length travel) const;
 	
+	// Validates the linear axes of each position in one pass.
+	void Validate(const std::vector<Position>& positions) const;
+	
+	/*
+	 * All steps of an expanded path outside the XYZ limits, in step then
+	 * axis order. Does not throw.
+	 * The extent of the path is checked first so a path within the
+	 * envelope costs a single bounding box reduction.
+	 */
+	std::vector<travel_violation> Violations(const path::path_t& path) const;
+	std::vector<travel_violation> Violations(const path::path_soa& path) const;
+	
 	// returns 0.0 for unspecified limit
 	// likely to be changed
 	units::length MaxTravel(Axis::Type axis) const;
@@ -62,8 +124,8 @@ public:
 class FeedRate
 {
 private:
-	std::map<Axis::Type, units::velocity> m_Linear;
-	std::map<Axis::Type, units::angular_velocity> m_Angular;
+	axis_table<units::velocity> m_Linear;
+	axis_table<units::angular_velocity> m_Angular;
 	units::velocity m_Global;
 public:
 	void SetGlobal(units::velocity limit);
@@ -74,6 +136,13 @@ public:
 	void Validate(Axis::Type axis, units::velocity rate) const;
 	void Validate(Axis::Type axis, units::angular_velocity rate) const;
 	
+	/*
+	 * Validates linear moves between consecutive positions at the given
+	 * cartesian (XYZ) feed rate. Each axis moves at its share of the rate;
+	 * moves with no cartesian motion are not fed at rate and are skipped.
+	 */
+	void Validate(const std::vector<Position>& positions, units::velocity rate) const;
+	
 	// returns global for unspecified limit
 	units::velocity MaxLinear(Axis::Type axis) const;
 	// returns zero for unspecified limit
@@ -88,12 +157,13 @@ public:
  * This simple class takes no consideration of acceleration or
  * deceleration, but provides an estimate for traversal times
  * for rapid moves from a begin point to an end point.
+ * motion::rapid_time accounts for limits::Acceleration.
  */
 class Rapids
 {
 private:
-	std::map<Axis::Type, units::velocity> m_Linear;
-	std::map<Axis::Type, units::angular_velocity> m_Angular;
+	axis_table<units::velocity> m_Linear;
+	axis_table<units::angular_velocity> m_Angular;
 	units::velocity m_Global;
 public:
 	void SetGlobal(units::velocity limit);
@@ -102,6 +172,9 @@ public:
 	
 	units::time Duration(const Position& begin, const Position& end) const;
 	
+	// Total duration of rapids between consecutive positions.
+	units::time Duration(const std::vector<Position>& positions) const;
+	
 	// returns global for unspecified rate
 	units::velocity LinearVelocity(Axis::Type axis) const;
 	
@@ -109,13 +182,71 @@ public:
 	units::angular_velocity AngularVelocity(Axis::Type axis) const;
 };
 
+/*
+ * Per axis acceleration and jerk limits used to estimate the time taken
+ * to reach and leave the traversal rate (see Motion.h).
+ * Unspecified limits are unbounded: an axis without an acceleration limit
+ * changes velocity instantly and one without a jerk limit follows a
+ * trapezoidal rather than S-curve profile.
+ */
+class Acceleration
+{
+private:
+	axis_table<units::acceleration> m_Linear;
+	axis_table<units::angular_acceleration> m_Angular;
+	axis_table<units::jerk> m_LinearJerk;
+	axis_table<units::angular_jerk> m_AngularJerk;
+public:
+	void Set(Axis::Type axis, units::acceleration limit);
+	void Set(Axis::Type axis, units::angular_acceleration limit);
+	void SetJerk(Axis::Type axis, units::jerk limit);
+	void SetJerk(Axis::Type axis, units::angular_jerk limit);
+	
+	// returns infinity for unspecified limit
+	units::acceleration MaxLinear(Axis::Type axis) const;
+	units::angular_acceleration MaxAngular(Axis::Type axis) const;
+	units::jerk MaxLinearJerk(Axis::Type axis) const;
+	units::angular_jerk MaxAngularJerk(Axis::Type axis) const;
+};
+
+/*
+ * Sets of axes as a mask with bit n set for Axis::Type n.
+ * UVW are not mapped into the step space so is_pure_xyz ignores them.
+ */
+constexpr unsigned axis_mask(Axis::Type axis)
+{
+	return 1u << static_cast<unsigned>(axis);
+}
+constexpr unsigned xyz_mask = axis_mask(Axis::Type::X) | axis_mask(Axis::Type::Y) | axis_mask(Axis::Type::Z);
+constexpr unsigned rotary_mask = axis_mask(Axis::Type::A) | axis_mask(Axis::Type::B) | axis_mask(Axis::Type::C);
+
+constexpr bool has_xyz(unsigned mask)
+{
+	return (mask & xyz_mask) == xyz_mask;
+}
+constexpr bool has_rotary(unsigned mask)
+{
+	return (mask & rotary_mask) != 0;
+}
+constexpr bool is_pure_xyz(unsigned mask)
+{
+	return has_xyz(mask) && !has_rotary(mask);
+}
+
+/*
+ * Axes of the machine in machine order; the order of the rotary axes
+ * determines how orientations are composed.
+ * Membership is a single mask test and copies do not allocate.
+ */
 class AvailableAxes
 {
 private:
-	std::vector<Axis::Type> axes;
+	std::array<Axis::Type, 9> m_Axes;
+	std::size_t m_Count;
+	unsigned m_Mask;
 public:
 	
-	typedef std::vector<Axis::Type>::const_iterator const_iterator;
+	typedef const Axis::Type* const_iterator;
 	
 	const_iterator begin() const;
 	const_iterator end() const;
@@ -124,10 +255,29 @@ public:
 	 * Default: XYZABCUVW
 	 */
 	AvailableAxes();
+	// Throws cxxcam::error if an axis is repeated.
 	explicit AvailableAxes(std::vector<Axis::Type> axes);
 	void Validate(Axis::Type axis) const;
+	
+	bool Has(Axis::Type axis) const
+	{
+		return (m_Mask & axis_mask(axis)) != 0;
+	}
+	unsigned Mask() const
+	{
+		return m_Mask;
+	}
 };
 
+inline bool has_rotary(const AvailableAxes& geometry)
+{
+	return has_rotary(geometry.Mask());
+}
+inline bool is_pure_xyz(const AvailableAxes& geometry)
+{
+	return is_pure_xyz(geometry.Mask());
+}
+
 }
 }
 
@@ -26,7 +26,11 @@
 #define MATERIAL_H_
 #include <string>
 #include <map>
+#include <vector>
+#include <array>
+#include <unordered_map>
 #include <stdexcept>
+#include <cstddef>
 
 namespace cxxcam
 {
@@ -118,12 +122,58 @@ struct Material
 	std::map<Tool, range_t<double>> surface_mmpm;
 };
 
+/*
+ * Material database.
+ * Materials are interned on name and grade; resolving a material once
+ * gives an id for constant time access to its properties.
+ *
+ * Bulk loaded from a flat file with one material per line:
+ *
+ * name,grade,hardness,machinability,hss_surface_mmpm,carbide_surface_mmpm
+ * Aluminium,6061-T6,95,1.9,75-105,
+ *
+ * Numeric fields are a value or a low-high range; empty fields are left
+ * unset. Blank lines and lines starting with '#' are ignored.
+ */
 class MaterialTable
 {
+public:
+	typedef std::size_t id_t;
+	static const id_t npos;
 private:
-	std::map<std::string, Material> table;
+	static const std::size_t tool_count = 2;
+	typedef std::array<Material::range_t<double>, tool_count> surface_t;
+	
+	std::vector<Material> m_Materials;
+	// Unset tools hold NaN.
+	std::vector<surface_t> m_Surface;
+	// Ids by hash of name and grade.
+	std::unordered_multimap<std::size_t, id_t> m_Index;
 public:
 	
+	// Adds or replaces the material with the same name and grade.
+	id_t Add(const Material& material);
+	
+	/*
+	 * Throws cxxcam::error if the file cannot be read or a line is
+	 * malformed; the table is then left unchanged.
+	 */
+	void Load(const std::string& filename);
+	void Parse(const char* data, std::size_t size);
+	
+	// npos if not in the table.
+	id_t Find(const std::string& name, const std::string& grade) const;
+	
+	const Material& Get(id_t id) const;
+	
+	/*
+	 * Surface speed range for a tool material; false if the material
+	 * has no surface speed for the tool. Throws cxxcam::error for an id
+	 * not in the table.
+	 */
+	bool SurfaceSpeed(id_t id, Material::Tool tool, Material::range_t<double>& surface_mmpm) const;
+	
+	std::size_t size() const;
 };
 
 }
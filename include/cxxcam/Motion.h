@@ -0,0 +1,96 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Motion.h
+ */
+
+#ifndef MOTION_H_
+#define MOTION_H_
+#include "Limits.h"
+#include "Path.h"
+#include "Position.h"
+#include "Units.h"
+#include <vector>
+#include <cstddef>
+
+namespace cxxcam
+{
+namespace motion
+{
+
+/*
+ * Time to travel a distance starting and finishing at rest without
+ * exceeding the velocity, acceleration and jerk limits (SI values).
+ * An infinite jerk gives a trapezoidal profile and an infinite
+ * acceleration constant velocity travel.
+ */
+double profile_time(double distance, double velocity, double acceleration, double jerk);
+
+/*
+ * Each axis moves independently at its rapid rate, accelerating and
+ * decelerating within its limits; the slowest axis determines the time.
+ * Throws cxxcam::error as Rapids::Duration for motion on an axis with no
+ * rapid rate.
+ */
+units::time rapid_time(const Position& begin, const Position& end, const limits::Rapids& rapids, const limits::Acceleration& acceleration);
+
+/*
+ * Feed moves at the cartesian rate `feed`, from rest to rest.
+ * The rate, acceleration and jerk along the path are reduced so that no
+ * axis exceeds its limits; arcs are further limited by the centripetal
+ * acceleration and jerk in the arc plane. Unset (zero) feed limits do not
+ * constrain the rate. Moves with no cartesian motion move each rotary axis
+ * independently at its angular feed limit.
+ */
+units::time linear_time(const Position& begin, const Position& end, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration);
+units::time arc_time(const path::arc_plan& arc, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration);
+
+units::time move_time(const path::move_t& move, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration);
+
+/*
+ * Blended feed motion over a sequence of moves.
+ */
+struct plan_t
+{
+	// Path velocity entering each move.
+	std::vector<units::velocity> entry;
+	std::vector<units::time> durations;
+	units::time duration;
+};
+
+/*
+ * Look-ahead trajectory planning for continuous (G64) motion.
+ * Moves do not stop at a junction unless required: the junction velocity
+ * is the speed at which a circular blend within `tolerance` of the corner
+ * stays within the acceleration limit of both moves, capped by their feed
+ * rates. A backward pass limits each junction so the machine can still
+ * stop by the end of the look-ahead window and a forward pass applies the
+ * acceleration limit; both are linear in the number of moves.
+ * `lookahead` bounds the number of moves considered beyond the current one;
+ * a short window is conservative, as on a controller with a short queue.
+ * Velocity changes along a move follow a trapezoidal profile; jerk limits
+ * are not applied. Moves with no cartesian motion start and end at rest.
+ * A zero tolerance stops at every corner (G61).
+ */
+plan_t plan(const std::vector<path::move_t>& moves, const std::vector<units::velocity>& feeds, const limits::FeedRate& limits, const limits::Acceleration& acceleration, units::length tolerance, std::size_t lookahead = 256);
+plan_t plan(const std::vector<path::move_t>& moves, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration, units::length tolerance, std::size_t lookahead = 256);
+
+}
+}
+
+#endif /* MOTION_H_ */
@@ -27,7 +27,12 @@
 #include "Position.h"
 #include "Math.h"
 #include "Limits.h"
+#include "Arena.h"
+#include "Bbox.h"
 #include <vector>
+#include <memory>
+#include <iterator>
+#include <cstddef>
 #include <iosfwd>
 
 namespace cxxcam
@@ -48,11 +53,148 @@ struct step
 
 std::ostream& operator<<(std::ostream& os, const step& step);
 
+/*
+ * Maximum deviation of the sampled path from the true path.
+ * chordal is the greatest distance between the chord joining consecutive
+ * steps and the true path; angular is the greatest rotary travel (in the
+ * pseudo cartesian ABC space) between consecutive steps.
+ */
+struct deviation_t
+{
+	units::length chordal;
+	units::plane_angle angular;
+};
+
 struct path_t
 {
 	std::vector<step> path;
 	units::length length;
 	units::plane_angle angular_length;
+	
+	// Achieved bound for the sampling used.
+	deviation_t deviation;
+};
+
+/*
+ * Structure of arrays step storage.
+ * Positions are stored as the units::length representation (metres)
+ * and orientations as quaternion components, each in a contiguous array.
+ */
+struct path_soa
+{
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> z;
+	
+	std::vector<double> qw;
+	std::vector<double> qx;
+	std::vector<double> qy;
+	std::vector<double> qz;
+	
+	units::length length;
+	units::plane_angle angular_length;
+	deviation_t deviation;
+	
+	std::size_t size() const;
+	bool empty() const;
+	void clear();
+	void reserve(std::size_t n);
+	void resize(std::size_t n);
+	
+	void push_back(const step& s);
+	void set(std::size_t i, const step& s);
+	step operator[](std::size_t i) const;
+};
+
+/*
+ * Lazily evaluated sequence of steps along a single move.
+ * Steps are computed as the range is iterated so memory use is constant
+ * regardless of the length of the move, and consumers may stop early.
+ * Iteration yields exactly the steps the corresponding expand_* function
+ * would produce.
+ */
+class step_range
+{
+public:
+	struct generator;
+
+	/*
+	 * Evaluation state carried from one step to the next
+	 * so generators can advance incrementally.
+	 */
+	struct rotation
+	{
+		double c;
+		double s;
+	};
+	struct cursor
+	{
+		std::size_t index;
+		
+		// cos and sin of the arc angle at index
+		rotation arc;
+		
+		// cos and sin of half the A, B and C axis angles at index
+		rotation rotary[3];
+	};
+
+	class const_iterator
+	{
+	private:
+		const step_range* m_Range;
+		std::size_t m_Index;
+		cursor m_Cursor;
+		step m_Step;
+		
+		void evaluate();
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef step value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const step* pointer;
+		typedef const step& reference;
+
+		const_iterator();
+		const_iterator(const step_range* range, std::size_t index);
+
+		reference operator*() const;
+		pointer operator->() const;
+
+		const_iterator& operator++();
+		const_iterator operator++(int);
+
+		bool operator==(const const_iterator& o) const;
+		bool operator!=(const const_iterator& o) const;
+	};
+private:
+	std::shared_ptr<const generator> m_Generator;
+	std::size_t m_Steps;
+	step m_End;
+	bool m_AppendEnd;
+	units::length m_Length;
+	units::plane_angle m_AngularLength;
+	deviation_t m_Deviation;
+public:
+	// Empty range
+	step_range();
+	
+	/*
+	 * steps is the number of interpolated steps produced by the generator.
+	 * The end step follows them iff append_end is set.
+	 */
+	step_range(std::shared_ptr<const generator> gen, std::size_t steps, const step& end, bool append_end, units::length length, units::plane_angle angular_length, const deviation_t& deviation);
+
+	const_iterator begin() const;
+	const_iterator end() const;
+	std::size_t size() const;
+	bool empty() const;
+
+	// Appends every step in the range to out.
+	void append(path_soa& out) const;
+
+	units::length length() const;
+	units::plane_angle angular_length() const;
+	deviation_t deviation() const;
 };
 
 /* if steps_per_mm < 0 then this will only expand linear motion IFF there is a corresponding
@@ -71,8 +213,182 @@ enum class ArcDirection
 
 path_t expand_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm = 10);
 
+/*
+ * Adaptive sampling.
+ * The step count is derived from the arc radius and rotary motion so that the
+ * path deviates by no more than the given tolerance. Straight moves without
+ * rotary motion expand to their start and end steps.
+ * Throws if either tolerance is not positive.
+ */
+path_t expand_linear(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+path_t expand_rotary(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+path_t expand_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+
+/*
+ * Streaming equivalents of the expand_* functions.
+ * The geometry is copied; the returned range does not reference the arguments.
+ */
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm = 10);
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree = 10);
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm = 10);
+
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+
+/*
+ * As above with the generator allocated from `storage`.
+ * The arena must not be reset while the returned range is in use.
+ */
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm, arena& storage);
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree, arena& storage);
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm, arena& storage);
+
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage);
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage);
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage);
+
+/*
+ * Geometry of an arc or helix, resolved once.
+ * The plane projection, radius and swept angle are shared by the length,
+ * extent and step generation so callers needing several of them (e.g. a
+ * cycle time estimate and the expanded path) do not repeat the work.
+ * Throws as expand_arc for an unsupported plane or a center not equidistant
+ * from start and end.
+ */
+class arc_plan
+{
+private:
+	Position m_Start;
+	Position m_End;
+	math::vector_3 m_Plane;
+	
+	// In plane coordinates (x, y) and helix axis offset of the arc.
+	math::point_3 m_Center;
+	units::length m_Radius;
+	units::length m_Helix;
+	
+	units::plane_angle m_StartTheta;
+	// Signed in plane sweep including full turns.
+	units::plane_angle m_Sweep;
+	units::length m_Length;
+	
+	step_range range(const limits::AvailableAxes& geometry, size_t steps_per_mm, const deviation_t* tolerance, arena* storage) const;
+public:
+	arc_plan(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns);
+	
+	const Position& start() const;
+	const Position& end() const;
+	
+	units::length length() const;
+	units::length radius() const;
+	// Travel along the helix axis (normal to the plane).
+	units::length helix() const;
+	const math::vector_3& plane() const;
+	// In plane angle of the start point about the center.
+	units::plane_angle start_angle() const;
+	// Unsigned in plane angle swept.
+	units::plane_angle angular_span() const;
+	// Signed in plane angle swept; positive is counter clockwise.
+	units::plane_angle sweep() const;
+	Bbox bounding_box() const;
+	
+	step_range steps(const limits::AvailableAxes& geometry, size_t steps_per_mm = 10) const;
+	step_range steps(const limits::AvailableAxes& geometry, const deviation_t& tolerance) const;
+	step_range steps(const limits::AvailableAxes& geometry, size_t steps_per_mm, arena& storage) const;
+	step_range steps(const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage) const;
+};
+
+/*
+ * A single move of a program.
+ * center, dir, plane and turns are only used for arcs.
+ */
+struct move_t
+{
+	enum class Type
+	{
+		Linear,
+		Rotary,
+		Arc
+	};
+	
+	Type type;
+	Position start;
+	Position end;
+	
+	Position_Cartesian center;
+	ArcDirection dir;
+	math::vector_3 plane;
+	double turns;
+	
+	move_t();
+};
+
+/*
+ * Steps of a whole program, concatenated in move order.
+ */
+struct program_t
+{
+	std::vector<step> path;
+	
+	// Index in path of the first step of each move.
+	std::vector<std::size_t> offsets;
+	
+	units::length length;
+	units::plane_angle angular_length;
+	
+	// Greatest deviation of any move.
+	deviation_t deviation;
+};
+
+/*
+ * steps_per_mm is used as steps_per_degree for rotary moves.
+ */
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, size_t steps_per_mm = 10);
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, const deviation_t& tolerance);
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, size_t steps_per_mm, arena& storage);
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage);
+
+/*
+ * Expands each move and concatenates the steps in order.
+ * Moves are expanded on up to `threads` threads (0 uses the hardware concurrency);
+ * the output is identical for any number of threads. If any move cannot be
+ * expanded the error from the first such move is thrown.
+ */
+program_t expand_program(const std::vector<move_t>& moves, const limits::AvailableAxes& geometry, size_t steps_per_mm = 10, unsigned threads = 0);
+program_t expand_program(const std::vector<move_t>& moves, const limits::AvailableAxes& geometry, const deviation_t& tolerance, unsigned threads = 0);
+
+path_t expand(const step_range& steps);
+path_soa expand_soa(const step_range& steps);
+
+/*
+ * Expands into an existing path, replacing its contents.
+ * Capacity is kept so a path reused across moves stops allocating once it
+ * has grown to the longest move.
+ */
+void expand_into(path_t& path, const step_range& steps);
+void expand_into(path_soa& path, const step_range& steps);
+
+template <typename Allocator>
+void expand_into(std::vector<step, Allocator>& path, const step_range& steps)
+{
+	path.clear();
+	path.reserve(steps.size());
+	for(const auto& step : steps)
+		path.push_back(step);
+}
+
 units::length length_linear(const Position& start, const Position& end);
 units::length length_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns);
+
+/*
+ * Extent of the cartesian motion of a move, computed without expansion.
+ * Arcs include the points where the circle crosses the axes through its
+ * center. The extent contains every step the move expands to.
+ */
+Bbox bbox_linear(const Position& start, const Position& end);
+Bbox bbox_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns);
+Bbox bbox_move(const move_t& move);
 }
 }
 
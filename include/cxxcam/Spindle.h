@@ -26,6 +26,8 @@
 #define SPINDLE_H_
 #include <string>
 #include <set>
+#include <vector>
+#include <cstddef>
 #include "Units.h"
 
 namespace cxxcam
@@ -46,6 +48,16 @@ private:
 			return rpm < o.rpm;
 		}
 	};
+	
+	struct Power
+	{
+		unsigned long rpm;
+		units::power power;
+		bool operator<(const Power& o) const
+		{
+			return rpm < o.rpm;
+		}
+	};
 
 	struct Speed
 	{
@@ -74,8 +86,11 @@ private:
 	};
 
 	std::set<Torque> m_Torque;
+	std::set<Power> m_Power;
 	std::set<Speed> m_Speed;
 	unsigned long m_Tolerance;
+	
+	friend class spindle_table;
 public:
 	explicit Spindle(unsigned long tolerance = 100);
 
@@ -92,14 +107,123 @@ public:
 	 * generated via simple linear interpolation.
 	 */
 	units::torque GetTorque(unsigned long speed) const;
+	
+	/*
+	 * Return the rated power at a given attainable speed, linearly
+	 * interpolated between samples and taking the nearest sample outside
+	 * them. Zero if no power curve is given.
+	 */
+	units::power GetPower(unsigned long speed) const;
 
 	void AddRange(unsigned long range_start, unsigned long range_end);
 	void AddDiscrete(unsigned long discrete_value);
 	void SetTorque(unsigned long rpm, units::torque torque);
+	void SetPower(unsigned long rpm, units::power power);
 
 	std::string str() const;
 };
 
+/*
+ * Spindle load required by a move, e.g. from the material removal rate.
+ * Either may be zero; the greater requirement at the speed applies.
+ */
+struct spindle_load
+{
+	unsigned long rpm;
+	units::torque torque;
+	units::power power;
+};
+
+/*
+ * Move whose load exceeds what the spindle delivers at the normalised speed.
+ * A requested speed outside the tolerance is reported with rpm set to
+ * spindle_table::unattainable and no available torque; the required torque
+ * is then for the requested speed.
+ */
+struct spindle_overload
+{
+	std::size_t move;
+	unsigned long rpm;
+	units::torque required;
+	units::torque available;
+};
+
+/*
+ * Snapshot of a Spindle for repeated lookups (e.g. feed / speed sweeps).
+ * Speeds and torque / power samples are held in sorted flat arrays with the
+ * interpolation slopes precomputed, so each lookup is a binary search.
+ * Later changes to the Spindle are not reflected.
+ */
+class spindle_table
+{
+private:
+	// Samples interpolated linearly and clamped to the end samples.
+	struct curve
+	{
+		std::vector<unsigned long> rpm;
+		std::vector<double> value;
+		std::vector<double> slope;
+		
+		void add(unsigned long rpm, double value);
+		double operator()(unsigned long speed) const;
+	};
+	
+	// Speed intervals by start; discrete speeds have equal bounds.
+	std::vector<unsigned long> m_Low;
+	std::vector<unsigned long> m_High;
+	// Greatest upper bound of the intervals up to and including each one.
+	std::vector<unsigned long> m_Reach;
+	unsigned long m_Tolerance;
+	
+	curve m_Torque;
+	curve m_Power;
+	
+	// Closest attainable speed regardless of tolerance.
+	unsigned long Closest(unsigned long requested_speed) const;
+public:
+	// Batch Normalise result for speeds outside the tolerance.
+	static const unsigned long unattainable;
+	
+	explicit spindle_table(const Spindle& spindle);
+	
+	/*
+	 * As Spindle::Normalise; ties between speeds equally far from the
+	 * requested speed go to the lower one.
+	 */
+	unsigned long Normalise(unsigned long requested_speed) const;
+	
+	/*
+	 * Normalises n requested speeds into speeds.
+	 * Speeds outside the tolerance are set to unattainable rather than
+	 * throwing; returns the number of such speeds.
+	 */
+	std::size_t Normalise(const unsigned long* requested_speeds, std::size_t n, unsigned long* speeds) const;
+	
+	/*
+	 * As Spindle::GetTorque. Speeds outside the samples take the torque of
+	 * the nearest sample.
+	 */
+	units::torque GetTorque(unsigned long speed) const;
+	void GetTorque(const unsigned long* speeds, std::size_t n, units::torque* torque) const;
+	
+	// As Spindle::GetPower.
+	units::power GetPower(unsigned long speed) const;
+	void GetPower(const unsigned long* speeds, std::size_t n, units::power* power) const;
+	
+	/*
+	 * Torque deliverable at an attainable speed; the lesser of the torque
+	 * curve and the power curve over the angular velocity. Curves that are
+	 * not given do not limit the torque.
+	 */
+	units::torque AvailableTorque(unsigned long speed) const;
+	
+	/*
+	 * Checks the load of each move at its normalised speed and returns the
+	 * moves that would stall the spindle, in move order.
+	 */
+	std::vector<spindle_overload> Overloads(const std::vector<spindle_load>& loads) const;
+};
+
 }
 
 #endif /* SPINDLE_H_ */
@@ -33,10 +33,13 @@
 
 #include <boost/units/systems/si/length.hpp>
 #include <boost/units/systems/si/torque.hpp>
+#include <boost/units/systems/si/power.hpp>
 #include <boost/units/systems/si/velocity.hpp>
 #include <boost/units/systems/si/volume.hpp>
 #include <boost/units/systems/si/time.hpp>
 #include <boost/units/systems/si/angular_velocity.hpp>
+#include <boost/units/systems/si/acceleration.hpp>
+#include <boost/units/systems/si/angular_acceleration.hpp>
 #include <boost/units/systems/si/plane_angle.hpp>
 #include <boost/units/systems/angle/degrees.hpp>
 
@@ -44,6 +47,11 @@
 
 #include <boost/units/base_units/metric/minute.hpp>
 
+#include <boost/units/derived_dimension.hpp>
+#include <boost/units/physical_dimensions/length.hpp>
+#include <boost/units/physical_dimensions/plane_angle.hpp>
+#include <boost/units/physical_dimensions/time.hpp>
+
 namespace cxxcam
 {
 namespace units
@@ -51,12 +59,21 @@ namespace units
 
 typedef boost::units::quantity<boost::units::si::length> length;
 typedef boost::units::quantity<boost::units::si::torque> torque;
+typedef boost::units::quantity<boost::units::si::power> power;
 typedef boost::units::quantity<boost::units::si::velocity> velocity;
 typedef boost::units::quantity<boost::units::si::volume> volume;
 // TODO is a static assert that time is represented as seconds necessary?
 typedef boost::units::quantity<boost::units::si::time> time;
 typedef boost::units::quantity<boost::units::si::angular_velocity> angular_velocity;
 typedef boost::units::quantity<boost::units::si::plane_angle> plane_angle;
+typedef boost::units::quantity<boost::units::si::acceleration> acceleration;
+typedef boost::units::quantity<boost::units::si::angular_acceleration> angular_acceleration;
+
+// boost.units defines no jerk (rate of change of acceleration) unit.
+typedef boost::units::derived_dimension<boost::units::length_base_dimension, 1, boost::units::time_base_dimension, -3>::type jerk_dimension;
+typedef boost::units::derived_dimension<boost::units::plane_angle_base_dimension, 1, boost::units::time_base_dimension, -3>::type angular_jerk_dimension;
+typedef boost::units::quantity<boost::units::unit<jerk_dimension, boost::units::si::system>> jerk;
+typedef boost::units::quantity<boost::units::unit<angular_jerk_dimension, boost::units::si::system>> angular_jerk;
 
 static const auto meter = boost::units::si::meter;
 static const auto meters = meter;
@@ -78,7 +95,14 @@ static const auto radians = boost::units::si::radians;
 static const auto degrees = boost::units::degree::degrees;
 static const auto degrees_per_second = degrees / second;
 
+static const auto millimeters_per_second_squared = millimeters / (second * second);
+static const auto millimeters_per_second_cubed = millimeters / (second * second * second);
+static const auto degrees_per_second_squared = degrees / (second * second);
+static const auto degrees_per_second_cubed = degrees / (second * second * second);
+
 static const auto newton_meters = boost::units::si::newton_meters;
+static const auto watts = boost::units::si::watts;
+static const auto kilowatts = boost::units::si::kilo * watts;
 
 typedef boost::units::quantity<decltype(millimeter)> length_mm;
 typedef boost::units::quantity<decltype(inch)> length_inch;
@@ -86,6 +110,7 @@ typedef boost::units::quantity<decltype(millimeters_per_minute)> velocity_mmpm;
 typedef boost::units::quantity<decltype(degrees)> plane_angle_deg;
 typedef boost::units::quantity<decltype(radians)> plane_angle_rads;
 typedef boost::units::quantity<decltype(newton_meters)> torque_nm;
+typedef boost::units::quantity<decltype(kilowatts)> power_kw;
 
 }
 }
@@ -0,0 +1,80 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Arena.cpp
+ */
+
+#include "cxxcam/Arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace cxxcam
+{
+
+arena::arena(std::size_t block_size)
+ : m_Blocks(), m_Block(0), m_Offset(0), m_BlockSize(block_size)
+{
+}
+
+void* arena::allocate(std::size_t size, std::size_t alignment)
+{
+	auto fit = [&](const block& b, std::size_t offset) -> std::size_t
+	{
+		auto address = reinterpret_cast<std::uintptr_t>(b.data.get()) + offset;
+		auto aligned = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+		return offset + (aligned - address);
+	};
+	
+	for(; m_Block < m_Blocks.size(); ++m_Block, m_Offset = 0)
+	{
+		auto& b = m_Blocks[m_Block];
+		auto offset = fit(b, m_Offset);
+		if(offset + size <= b.size)
+		{
+			m_Offset = offset + size;
+			return b.data.get() + offset;
+		}
+	}
+	
+	block b;
+	b.size = std::max(m_BlockSize, size + alignment);
+	b.data.reset(new char[b.size]);
+	m_Blocks.push_back(std::move(b));
+	
+	m_Block = m_Blocks.size() - 1;
+	auto offset = fit(m_Blocks.back(), 0);
+	m_Offset = offset + size;
+	return m_Blocks.back().data.get() + offset;
+}
+
+void arena::reset()
+{
+	m_Block = 0;
+	m_Offset = 0;
+}
+
+std::size_t arena::capacity() const
+{
+	std::size_t size = 0;
+	for(auto& b : m_Blocks)
+		size += b.size;
+	return size;
+}
+
+}
+
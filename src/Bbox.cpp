@@ -24,8 +24,12 @@
 
 #include "cxxcam/Bbox.h"
 #include <algorithm>
-#include <numeric>
+#include <tuple>
 #include <ostream>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "Parallel.h"
 
 namespace cxxcam
 {
@@ -86,12 +90,147 @@ Bbox& Bbox::operator+=(const math::point_3& p)
 	return *this;
 }
 
-Bbox construct(const std::vector<math::point_3>& points)
+namespace
+{
+
+// Points per parallel block; smaller sets are reduced on the calling thread.
+const std::size_t reduce_block = 1 << 16;
+
+/*
+ * Extends [lo, hi] by v[0, n).
+ */
+void extent(const double* v, std::size_t n, double& lo, double& hi)
+{
+	std::size_t i = 0;
+#if defined(__AVX__)
+	if(n >= 8)
+	{
+		auto lo0 = _mm256_set1_pd(lo);
+		auto hi0 = _mm256_set1_pd(hi);
+		auto lo1 = lo0;
+		auto hi1 = hi0;
+		for(; i + 8 <= n; i += 8)
+		{
+			auto a = _mm256_loadu_pd(v + i);
+			auto b = _mm256_loadu_pd(v + i + 4);
+			lo0 = _mm256_min_pd(lo0, a);
+			hi0 = _mm256_max_pd(hi0, a);
+			lo1 = _mm256_min_pd(lo1, b);
+			hi1 = _mm256_max_pd(hi1, b);
+		}
+		double l[4];
+		double h[4];
+		_mm256_storeu_pd(l, _mm256_min_pd(lo0, lo1));
+		_mm256_storeu_pd(h, _mm256_max_pd(hi0, hi1));
+		for(int k = 0; k < 4; ++k)
+		{
+			lo = std::min(lo, l[k]);
+			hi = std::max(hi, h[k]);
+		}
+	}
+#elif defined(__SSE2__)
+	if(n >= 4)
+	{
+		auto lo0 = _mm_set1_pd(lo);
+		auto hi0 = _mm_set1_pd(hi);
+		auto lo1 = lo0;
+		auto hi1 = hi0;
+		for(; i + 4 <= n; i += 4)
+		{
+			auto a = _mm_loadu_pd(v + i);
+			auto b = _mm_loadu_pd(v + i + 2);
+			lo0 = _mm_min_pd(lo0, a);
+			hi0 = _mm_max_pd(hi0, a);
+			lo1 = _mm_min_pd(lo1, b);
+			hi1 = _mm_max_pd(hi1, b);
+		}
+		double l[2];
+		double h[2];
+		_mm_storeu_pd(l, _mm_min_pd(lo0, lo1));
+		_mm_storeu_pd(h, _mm_max_pd(hi0, hi1));
+		for(int k = 0; k < 2; ++k)
+		{
+			lo = std::min(lo, l[k]);
+			hi = std::max(hi, h[k]);
+		}
+	}
+#endif
+	for(; i < n; ++i)
+	{
+		lo = std::min(lo, v[i]);
+		hi = std::max(hi, v[i]);
+	}
+}
+
+Bbox make_bbox(const double lo[3], const double hi[3])
+{
+	return { {units::length::from_value(lo[0]), units::length::from_value(lo[1]), units::length::from_value(lo[2])},
+	         {units::length::from_value(hi[0]), units::length::from_value(hi[1]), units::length::from_value(hi[2])} };
+}
+
+/*
+ * Reduces blocks of [0, n) with f(first, last) on up to `threads` threads
+ * and combines the partial boxes.
+ */
+template <typename F>
+Bbox reduce(std::size_t n, unsigned threads, F f)
+{
+	if(threads == 1 || n <= reduce_block)
+		return f(0, n);
+	
+	std::vector<Bbox> partial((n + reduce_block - 1) / reduce_block);
+	parallel::for_blocks(n, reduce_block, threads, [&](std::size_t first, std::size_t last)
+	{
+		for(auto b = first; b < last; b += reduce_block)
+			partial[b / reduce_block] = f(b, std::min(last, b + reduce_block));
+	});
+	
+	auto box = partial.front();
+	for(auto& b : partial)
+		box += b;
+	return box;
+}
+
+}
+
+Bbox construct(const std::vector<math::point_3>& points, unsigned threads)
 {
 	if(points.empty())
 		return {};
-		
-	return std::accumulate(begin(points), end(points), Bbox { points.front(), points.front() });
+	
+	return reduce(points.size(), threads, [&](std::size_t first, std::size_t last) -> Bbox
+	{
+		auto& p0 = points[first];
+		double lo[3] = {p0.x.value(), p0.y.value(), p0.z.value()};
+		double hi[3] = {lo[0], lo[1], lo[2]};
+		for(auto i = first; i < last; ++i)
+		{
+			auto& p = points[i];
+			lo[0] = std::min(lo[0], p.x.value());
+			lo[1] = std::min(lo[1], p.y.value());
+			lo[2] = std::min(lo[2], p.z.value());
+			hi[0] = std::max(hi[0], p.x.value());
+			hi[1] = std::max(hi[1], p.y.value());
+			hi[2] = std::max(hi[2], p.z.value());
+		}
+		return make_bbox(lo, hi);
+	});
+}
+
+Bbox construct(const double* x, const double* y, const double* z, std::size_t n, unsigned threads)
+{
+	if(n == 0)
+		return {};
+	
+	return reduce(n, threads, [&](std::size_t first, std::size_t last) -> Bbox
+	{
+		double lo[3] = {x[first], y[first], z[first]};
+		double hi[3] = {lo[0], lo[1], lo[2]};
+		extent(x + first, last - first, lo[0], hi[0]);
+		extent(y + first, last - first, lo[1], hi[1]);
+		extent(z + first, last - first, lo[2], hi[2]);
+		return make_bbox(lo, hi);
+	});
 }
 
 std::ostream& operator<<(std::ostream& os, const Bbox& b)
@@ -0,0 +1,390 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bvh.cpp
+ */
+
+#include "cxxcam/Bvh.h"
+#include <algorithm>
+
+namespace cxxcam
+{
+namespace path
+{
+
+namespace
+{
+
+// Consecutive segments per leaf.
+const std::size_t leaf_size = 8;
+
+double sq(double v)
+{
+	return v * v;
+}
+
+// Distance outside [lo, hi] along one axis.
+double gap(double v, double lo, double hi)
+{
+	return std::max(std::max(lo - v, v - hi), 0.0);
+}
+
+double point_segment2(const double p[3], const double s[3], const double e[3])
+{
+	double d[3] = {e[0] - s[0], e[1] - s[1], e[2] - s[2]};
+	auto dd = sq(d[0]) + sq(d[1]) + sq(d[2]);
+	auto t = 0.0;
+	if(dd > 0)
+		t = std::min(std::max(((p[0] - s[0]) * d[0] + (p[1] - s[1]) * d[1] + (p[2] - s[2]) * d[2]) / dd, 0.0), 1.0);
+	return sq(s[0] + t * d[0] - p[0]) + sq(s[1] + t * d[1] - p[1]) + sq(s[2] + t * d[2] - p[2]);
+}
+
+/*
+ * Slab test of the closed segment against the closed box.
+ */
+bool segment_intersects(const double s[3], const double e[3], const double min[3], const double max[3])
+{
+	auto t0 = 0.0;
+	auto t1 = 1.0;
+	for(int i = 0; i < 3; ++i)
+	{
+		auto d = e[i] - s[i];
+		if(d == 0)
+		{
+			if(s[i] < min[i] || s[i] > max[i])
+				return false;
+			continue;
+		}
+		auto ta = (min[i] - s[i]) / d;
+		auto tb = (max[i] - s[i]) / d;
+		if(ta > tb)
+			std::swap(ta, tb);
+		t0 = std::max(t0, ta);
+		t1 = std::min(t1, tb);
+		if(t0 > t1)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Squared distance between a segment and a box.
+ * Along the segment the squared distance is a convex quadratic between the
+ * parameters where a coordinate crosses a face plane, so each piece is
+ * minimised in closed form.
+ */
+double segment_box2(const double s[3], const double e[3], const double min[3], const double max[3])
+{
+	if(segment_intersects(s, e, min, max))
+		return 0;
+	
+	double d[3] = {e[0] - s[0], e[1] - s[1], e[2] - s[2]};
+	auto f = [&](double t)
+	{
+		double r = 0;
+		for(int i = 0; i < 3; ++i)
+			r += sq(gap(s[i] + t * d[i], min[i], max[i]));
+		return r;
+	};
+	
+	double breaks[8] = {0, 1};
+	std::size_t n = 2;
+	for(int i = 0; i < 3; ++i)
+	{
+		if(d[i] == 0)
+			continue;
+		for(auto plane : {min[i], max[i]})
+		{
+			auto t = (plane - s[i]) / d[i];
+			if(t > 0 && t < 1)
+				breaks[n++] = t;
+		}
+	}
+	// At most eight values; insertion sort.
+	for(std::size_t k = 1; k < n; ++k)
+		for(auto j = k; j > 0 && breaks[j] < breaks[j - 1]; --j)
+			std::swap(breaks[j], breaks[j - 1]);
+	
+	auto best = std::min(f(0), f(1));
+	for(std::size_t k = 0; k + 1 < n; ++k)
+	{
+		auto ta = breaks[k];
+		auto tb = breaks[k + 1];
+		auto tm = (ta + tb) / 2;
+		
+		// Axes outside the box over this piece contribute (a + b t)^2.
+		double ab = 0;
+		double bb = 0;
+		for(int i = 0; i < 3; ++i)
+		{
+			auto v = s[i] + tm * d[i];
+			double a;
+			if(v < min[i])
+				a = s[i] - min[i];
+			else if(v > max[i])
+				a = s[i] - max[i];
+			else
+				continue;
+			ab += a * d[i];
+			bb += d[i] * d[i];
+		}
+		auto t = bb > 0 ? std::min(std::max(-ab / bb, ta), tb) : tm;
+		best = std::min(best, f(t));
+	}
+	return best;
+}
+
+}
+
+segment_bvh::box& segment_bvh::box::operator+=(const box& b)
+{
+	for(int i = 0; i < 3; ++i)
+	{
+		min[i] = std::min(min[i], b.min[i]);
+		max[i] = std::max(max[i], b.max[i]);
+	}
+	return *this;
+}
+
+segment_bvh::segment_bvh()
+{
+}
+segment_bvh::segment_bvh(const std::vector<step>& path)
+{
+	append(path);
+}
+
+void segment_bvh::append(double x, double y, double z)
+{
+	m_X.push_back(x);
+	m_Y.push_back(y);
+	m_Z.push_back(z);
+	if(m_X.size() < 2)
+		return;
+	
+	auto segment = m_X.size() - 2;
+	auto b = segment_box(segment);
+	auto leaf = segment / leaf_size;
+	
+	if(m_Levels.empty())
+		m_Levels.emplace_back();
+	
+	for(std::size_t k = 0; k < m_Levels.size(); ++k)
+	{
+		auto& level = m_Levels[k];
+		auto node = leaf >> k;
+		if(node == level.size())
+			level.push_back(b);
+		else
+			level[node] += b;
+	}
+	
+	while(m_Levels.back().size() > 1)
+	{
+		auto& below = m_Levels.back();
+		std::vector<box> level;
+		for(std::size_t i = 0; i < below.size(); i += 2)
+		{
+			level.push_back(below[i]);
+			if(i + 1 < below.size())
+				level.back() += below[i + 1];
+		}
+		m_Levels.push_back(std::move(level));
+	}
+}
+
+void segment_bvh::append(const math::point_3& p)
+{
+	append(p.x.value(), p.y.value(), p.z.value());
+}
+void segment_bvh::append(const std::vector<step>& path)
+{
+	for(auto& s : path)
+		append(s.position);
+}
+void segment_bvh::append(const path_soa& path)
+{
+	for(std::size_t i = 0; i < path.size(); ++i)
+		append(path.x[i], path.y[i], path.z[i]);
+}
+
+void segment_bvh::clear()
+{
+	m_X.clear();
+	m_Y.clear();
+	m_Z.clear();
+	m_Levels.clear();
+}
+
+std::size_t segment_bvh::size() const
+{
+	return m_X.size() < 2 ? 0 : m_X.size() - 1;
+}
+bool segment_bvh::empty() const
+{
+	return size() == 0;
+}
+
+math::point_3 segment_bvh::start(std::size_t segment) const
+{
+	return {units::length::from_value(m_X[segment]), units::length::from_value(m_Y[segment]), units::length::from_value(m_Z[segment])};
+}
+math::point_3 segment_bvh::end(std::size_t segment) const
+{
+	return start(segment + 1);
+}
+
+Bbox segment_bvh::bounds() const
+{
+	if(m_Levels.empty())
+		return {};
+	
+	auto& b = m_Levels.back().front();
+	return { {units::length::from_value(b.min[0]), units::length::from_value(b.min[1]), units::length::from_value(b.min[2])},
+	         {units::length::from_value(b.max[0]), units::length::from_value(b.max[1]), units::length::from_value(b.max[2])} };
+}
+
+segment_bvh::box segment_bvh::segment_box(std::size_t segment) const
+{
+	auto i = segment;
+	auto j = segment + 1;
+	return { {std::min(m_X[i], m_X[j]), std::min(m_Y[i], m_Y[j]), std::min(m_Z[i], m_Z[j])},
+	         {std::max(m_X[i], m_X[j]), std::max(m_Y[i], m_Y[j]), std::max(m_Z[i], m_Z[j])} };
+}
+
+/*
+ * Visits the leaves whose ancestors all pass test, in path order.
+ * Stops and returns true once visit returns true.
+ */
+template <typename Test, typename Visit>
+bool segment_bvh::traverse(std::size_t level, std::size_t node, const Test& test, const Visit& visit) const
+{
+	if(!test(m_Levels[level][node]))
+		return false;
+	if(level == 0)
+		return visit(node);
+	
+	auto& below = m_Levels[level - 1];
+	for(auto child : {2 * node, 2 * node + 1})
+	{
+		if(child < below.size() && traverse(level - 1, child, test, visit))
+			return true;
+	}
+	return false;
+}
+
+std::vector<std::size_t> segment_bvh::within(const math::point_3& p, units::length d) const
+{
+	std::vector<std::size_t> segments;
+	if(empty())
+		return segments;
+	
+	const double q[3] = {p.x.value(), p.y.value(), p.z.value()};
+	const auto d2 = sq(d.value());
+	
+	auto test = [&](const box& b)
+	{
+		return sq(gap(q[0], b.min[0], b.max[0])) + sq(gap(q[1], b.min[1], b.max[1])) + sq(gap(q[2], b.min[2], b.max[2])) <= d2;
+	};
+	auto visit = [&](std::size_t leaf)
+	{
+		auto last = std::min(size(), (leaf + 1) * leaf_size);
+		for(auto i = leaf * leaf_size; i < last; ++i)
+		{
+			const double s[3] = {m_X[i], m_Y[i], m_Z[i]};
+			const double e[3] = {m_X[i+1], m_Y[i+1], m_Z[i+1]};
+			if(point_segment2(q, s, e) <= d2)
+				segments.push_back(i);
+		}
+		return false;
+	};
+	traverse(m_Levels.size() - 1, 0, test, visit);
+	return segments;
+}
+
+std::vector<std::size_t> segment_bvh::within(const Bbox& region, units::length d) const
+{
+	std::vector<std::size_t> segments;
+	if(empty())
+		return segments;
+	
+	const double min[3] = {region.min.x.value(), region.min.y.value(), region.min.z.value()};
+	const double max[3] = {region.max.x.value(), region.max.y.value(), region.max.z.value()};
+	const auto d2 = sq(d.value());
+	
+	auto test = [&](const box& b)
+	{
+		double r = 0;
+		for(int i = 0; i < 3; ++i)
+			r += sq(std::max(std::max(b.min[i] - max[i], min[i] - b.max[i]), 0.0));
+		return r <= d2;
+	};
+	auto visit = [&](std::size_t leaf)
+	{
+		auto last = std::min(size(), (leaf + 1) * leaf_size);
+		for(auto i = leaf * leaf_size; i < last; ++i)
+		{
+			const double s[3] = {m_X[i], m_Y[i], m_Z[i]};
+			const double e[3] = {m_X[i+1], m_Y[i+1], m_Z[i+1]};
+			if(segment_box2(s, e, min, max) <= d2)
+				segments.push_back(i);
+		}
+		return false;
+	};
+	traverse(m_Levels.size() - 1, 0, test, visit);
+	return segments;
+}
+
+std::size_t segment_bvh::first_entering(const Bbox& region) const
+{
+	if(empty())
+		return npos;
+	
+	const double min[3] = {region.min.x.value(), region.min.y.value(), region.min.z.value()};
+	const double max[3] = {region.max.x.value(), region.max.y.value(), region.max.z.value()};
+	
+	auto test = [&](const box& b)
+	{
+		for(int i = 0; i < 3; ++i)
+			if(b.min[i] > max[i] || b.max[i] < min[i])
+				return false;
+		return true;
+	};
+	auto first = npos;
+	auto visit = [&](std::size_t leaf)
+	{
+		auto last = std::min(size(), (leaf + 1) * leaf_size);
+		for(auto i = leaf * leaf_size; i < last; ++i)
+		{
+			const double s[3] = {m_X[i], m_Y[i], m_Z[i]};
+			const double e[3] = {m_X[i+1], m_Y[i+1], m_Z[i+1]};
+			if(segment_intersects(s, e, min, max))
+			{
+				first = i;
+				return true;
+			}
+		}
+		return false;
+	};
+	traverse(m_Levels.size() - 1, 0, test, visit);
+	return first;
+}
+
+}
+}
+
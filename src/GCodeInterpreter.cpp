@@ -0,0 +1,417 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * GCodeInterpreter.cpp
+ */
+
+#include "cxxcam/GCodeInterpreter.h"
+#include "cxxcam/Error.h"
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+namespace cxxcam
+{
+namespace gcode
+{
+
+namespace
+{
+
+[[noreturn]] void fail(std::size_t number, const std::string& what)
+{
+	throw error("G-code line " + std::to_string(number) + ": " + what);
+}
+
+std::string str(const Word& word)
+{
+	char buffer[64];
+	auto n = format(buffer, sizeof(buffer), word);
+	return {buffer, std::min(n, sizeof(buffer))};
+}
+
+bool unsupported(double g)
+{
+	return (g >= 5 && g < 6) || g == 10 || g == 28 || g == 30 || (g >= 33 && g < 34) ||
+	       (g >= 38 && g < 39) || (g >= 41 && g < 44) || g == 52 || g == 53 ||
+	       (g >= 54 && g < 60) || g == 73 || g == 76 || (g >= 81 && g <= 89) ||
+	       g == 92 || g == 92.3 || g == 93 || g == 95;
+}
+
+/*
+ * Non-motion codes whose P word is not an arc turn count: dwell time and
+ * path blending tolerance.
+ */
+bool owns_p(double g)
+{
+	return g == 4 || g == 64;
+}
+
+/*
+ * Coordinates of the arc plane, mapped as in path::arc_plan.
+ * G2 / G3 are viewed from the positive end of the plane normal; for G18
+ * and G19 the pairs (X, Z) and (Z, Y) are viewed from the negative end,
+ * so arcs in those planes run in the opposite direction in the pair.
+ */
+struct plane_point
+{
+	double a;
+	double b;
+};
+
+plane_point in_plane(const Position_Cartesian& p, Interpreter::Plane plane)
+{
+	switch(plane)
+	{
+		case Interpreter::Plane::XY:
+			return {p.X.value(), p.Y.value()};
+		case Interpreter::Plane::ZX:
+			return {p.X.value(), p.Z.value()};
+		case Interpreter::Plane::YZ:
+			return {p.Z.value(), p.Y.value()};
+	}
+	return {};
+}
+void set_in_plane(Position_Cartesian& p, Interpreter::Plane plane, const plane_point& c)
+{
+	auto a = units::length::from_value(c.a);
+	auto b = units::length::from_value(c.b);
+	switch(plane)
+	{
+		case Interpreter::Plane::XY:
+			p.X = a;
+			p.Y = b;
+			break;
+		case Interpreter::Plane::ZX:
+			p.X = a;
+			p.Z = b;
+			break;
+		case Interpreter::Plane::YZ:
+			p.Z = a;
+			p.Y = b;
+			break;
+	}
+}
+
+bool mirrored(Interpreter::Plane plane)
+{
+	return plane != Interpreter::Plane::XY;
+}
+
+math::vector_3 plane_normal(Interpreter::Plane plane)
+{
+	switch(plane)
+	{
+		case Interpreter::Plane::XY:
+			return {0, 0, 1};
+		case Interpreter::Plane::ZX:
+			return {0, 1, 0};
+		case Interpreter::Plane::YZ:
+			return {1, 0, 0};
+	}
+	return {};
+}
+
+// Allowed difference between the start and end radii of an arc (metres).
+double radius_tolerance(double radius)
+{
+	return std::max(0.002e-3, radius * 1e-3);
+}
+
+}
+
+Interpreter::Interpreter()
+ : Interpreter(modal_t{})
+{
+}
+Interpreter::Interpreter(const modal_t& modal)
+ : m_Modal(modal), m_Motion(Motion::None), m_Plane(Plane::XY), m_AbsoluteArcs(false), m_Speed(0), m_Spindle(SpindleDirection::Stop), m_Lines(0)
+{
+}
+
+bool Interpreter::Apply(const program_t::word_t* first, const program_t::word_t* last, std::size_t number, motion_t& motion)
+{
+	bool axes = false;
+	bool offsets = false;
+	bool radius = false;
+	double ijk[3] = {0, 0, 0};
+	double r = 0;
+	double p = 0;
+	bool has_p = false;
+	bool p_owned = false;
+	
+	for(auto word = first; word != last; ++word)
+	{
+		auto v = word->value;
+		switch(word->code)
+		{
+			case Word::G:
+				if(unsupported(v))
+					fail(number, str(Word(Word::G, v)) + " is not supported");
+				else if(owns_p(v))
+					p_owned = true;
+				else if(v == 40 || v == 49 || v == 92.1 || v == 92.2)
+					break;	// Offset cancels; no offset can be active.
+				else if(v == 0)
+					m_Motion = Motion::Rapid;
+				else if(v == 1)
+					m_Motion = Motion::Linear;
+				else if(v == 2)
+					m_Motion = Motion::ClockwiseArc;
+				else if(v == 3)
+					m_Motion = Motion::CounterClockwiseArc;
+				else if(v == 80)
+					m_Motion = Motion::None;
+				else if(v == 17)
+					m_Plane = Plane::XY;
+				else if(v == 18)
+					m_Plane = Plane::ZX;
+				else if(v == 19)
+					m_Plane = Plane::YZ;
+				else if(v == 90.1)
+					m_AbsoluteArcs = true;
+				else if(v == 91.1)
+					m_AbsoluteArcs = false;
+				break;
+			case Word::M:
+				if(v == 3)
+					m_Spindle = SpindleDirection::Clockwise;
+				else if(v == 4)
+					m_Spindle = SpindleDirection::CounterClockwise;
+				else if(v == 5)
+					m_Spindle = SpindleDirection::Stop;
+				break;
+			case Word::S:
+				if(v < 0)
+					fail(number, "negative spindle speed");
+				m_Speed = std::lround(v);
+				break;
+			case Word::X:
+			case Word::Y:
+			case Word::Z:
+			case Word::A:
+			case Word::B:
+			case Word::C:
+			case Word::U:
+			case Word::V:
+			case Word::W:
+				axes = true;
+				break;
+			case Word::I:
+				ijk[0] = v;
+				offsets = true;
+				break;
+			case Word::J:
+				ijk[1] = v;
+				offsets = true;
+				break;
+			case Word::K:
+				ijk[2] = v;
+				offsets = true;
+				break;
+			case Word::R:
+				r = v;
+				radius = true;
+				break;
+			case Word::P:
+				p = v;
+				has_p = true;
+				break;
+			default:
+				break;
+		}
+	}
+	
+	auto start = m_Modal.position;
+	m_Modal.apply(first, last);
+	if(!axes)
+		return false;
+	if(m_Motion == Motion::None)
+		fail(number, "axis words without a motion mode");
+	
+	motion.move = path::move_t();
+	motion.move.start = start;
+	motion.move.end = m_Modal.position;
+	motion.rapid = m_Motion == Motion::Rapid;
+	motion.feed = m_Modal.feed;
+	motion.speed = m_Speed;
+	motion.spindle = m_Spindle;
+	
+	auto& move = motion.move;
+	if(m_Motion == Motion::Rapid || m_Motion == Motion::Linear)
+	{
+		if(move.end == move.start)
+			return false;
+		
+		auto& s = move.start;
+		auto& e = move.end;
+		auto linear = s.X != e.X || s.Y != e.Y || s.Z != e.Z || s.U != e.U || s.V != e.V || s.W != e.W;
+		move.type = linear ? path::move_t::Type::Linear : path::move_t::Type::Rotary;
+		return true;
+	}
+	
+	// Arc
+	auto scale = units::length{(m_Modal.metric ? 1.0 : 25.4) * units::millimeters}.value();
+	auto s = in_plane(move.start, m_Plane);
+	auto e = in_plane(move.end, m_Plane);
+	auto da = e.a - s.a;
+	auto db = e.b - s.b;
+	auto chord = std::sqrt(da*da + db*db);
+	// Direction in the plane coordinates.
+	auto ccw = (m_Motion == Motion::CounterClockwiseArc) != mirrored(m_Plane);
+	
+	// P is the number of turns unless a code on the line uses it.
+	double turns = 1;
+	if(has_p && !p_owned)
+	{
+		if(!(p >= 1) || p != std::floor(p))
+			fail(number, "arc turns must be a positive integer");
+		turns = p;
+	}
+	
+	plane_point c;
+	if(radius)
+	{
+		if(chord == 0)
+			fail(number, "R arc with coincident start and end");
+		
+		auto half = chord / 2;
+		auto rr = std::abs(r) * scale;
+		if(half - rr > radius_tolerance(rr))
+			fail(number, "arc radius too small for the move");
+		auto h = rr > half ? std::sqrt(rr*rr - half*half) : 0.0;
+		
+		// Arcs of up to half a turn have the center to the left of the
+		// chord when counter clockwise; negative R selects the longer arc.
+		auto side = (ccw == (r > 0)) ? h / chord : -h / chord;
+		c = {(s.a + e.a) / 2 - db * side, (s.b + e.b) / 2 + da * side};
+	}
+	else if(offsets)
+	{
+		Position_Cartesian offset;
+		offset.X = units::length::from_value(ijk[0] * scale);
+		offset.Y = units::length::from_value(ijk[1] * scale);
+		offset.Z = units::length::from_value(ijk[2] * scale);
+		c = in_plane(offset, m_Plane);
+		if(!m_AbsoluteArcs)
+		{
+			c.a += s.a;
+			c.b += s.b;
+		}
+		
+		auto r0 = std::hypot(s.a - c.a, s.b - c.b);
+		auto r1 = std::hypot(e.a - c.a, e.b - c.b);
+		if(std::abs(r0 - r1) > radius_tolerance(std::max(r0, r1)))
+			fail(number, "arc center not equidistant from start and end");
+		if(r0 == 0)
+			fail(number, "arc of zero radius");
+		
+		if(chord > 0)
+		{
+			// Onto the perpendicular bisector of the chord.
+			auto ma = (s.a + e.a) / 2;
+			auto mb = (s.b + e.b) / 2;
+			auto t = ((c.a - ma) * da + (c.b - mb) * db) / (chord * chord);
+			c.a -= t * da;
+			c.b -= t * db;
+		}
+	}
+	else
+	{
+		fail(number, "arc without a center");
+	}
+	
+	move.type = path::move_t::Type::Arc;
+	move.center = move.start;
+	set_in_plane(move.center, m_Plane, c);
+	move.dir = ccw ? path::ArcDirection::CounterClockwise : path::ArcDirection::Clockwise;
+	move.plane = plane_normal(m_Plane);
+	move.turns = turns;
+	return true;
+}
+
+bool Interpreter::Apply(const Line& line, motion_t& motion)
+{
+	m_Words.clear();
+	for(auto& word : line)
+		m_Words.push_back({word, program_t::no_comment, word.Value()});
+	
+	motion.line = m_Lines++;
+	auto first = m_Words.data();
+	return Apply(first, first + m_Words.size(), m_Lines, motion);
+}
+bool Interpreter::Apply(const program_t& program, std::size_t i, motion_t& motion)
+{
+	auto& line = program.lines.at(i);
+	auto first = program.words.data() + line.first;
+	
+	++m_Lines;
+	motion.line = i;
+	return Apply(first, first + line.count, line.number, motion);
+}
+
+std::vector<motion_t> Interpreter::Run(const std::vector<Line>& lines)
+{
+	std::vector<motion_t> motions;
+	motion_t motion;
+	for(std::size_t i = 0; i < lines.size(); ++i)
+	{
+		if(Apply(lines[i], motion))
+		{
+			motion.line = i;
+			motions.push_back(motion);
+		}
+	}
+	return motions;
+}
+std::vector<motion_t> Interpreter::Run(const program_t& program)
+{
+	std::vector<motion_t> motions;
+	motion_t motion;
+	for(std::size_t i = 0; i < program.size(); ++i)
+	{
+		if(Apply(program, i, motion))
+			motions.push_back(motion);
+	}
+	return motions;
+}
+
+const modal_t& Interpreter::Modal() const
+{
+	return m_Modal;
+}
+auto Interpreter::MotionMode() const -> Motion
+{
+	return m_Motion;
+}
+auto Interpreter::ActivePlane() const -> Plane
+{
+	return m_Plane;
+}
+unsigned long Interpreter::SpindleSpeed() const
+{
+	return m_Speed;
+}
+auto Interpreter::Spindle() const -> SpindleDirection
+{
+	return m_Spindle;
+}
+
+}
+}
@@ -23,7 +23,7 @@
  */
 
 #include "cxxcam/GCodeLine.h"
-#include <sstream>
+#include <algorithm>
 
 namespace cxxcam
 {
@@ -60,7 +60,7 @@ void Line::Comment(const std::string& comment)
 {
 	m_Comment = comment;
 }
-std::string Line::Comment() const
+const std::string& Line::Comment() const
 {
 	return m_Comment;
 }
@@ -73,28 +73,43 @@ Line& Line::operator+=(const Word& word)
 
 std::string Line::debug_str() const
 {
-	std::stringstream s;
+	std::string s(format(nullptr, 0, *this), 0);
+	format(&s[0], s.size(), *this);
+	return s;
+}
 
-	auto word = begin();
-	while(word != end())
+std::size_t format(char* buffer, std::size_t size, const Line& line)
+{
+	std::size_t length = 0;
+	auto put = [&](char c)
 	{
-		s << *word++;
-		if(word != end())
-			s << " ";
+		if(length < size)
+			buffer[length] = c;
+		++length;
+	};
+	
+	for(auto word = line.begin(); word != line.end(); ++word)
+	{
+		if(word != line.begin())
+			put(' ');
+		length += format(buffer + std::min(length, size), length < size ? size - length : 0, *word);
 	}
-
-	if(!Comment().empty())
+	
+	auto& comment = line.Comment();
+	if(!comment.empty())
 	{
-		if(!empty())
-			s << " ";
-		s << "; " << Comment();
+		if(!line.empty())
+			put(' ');
+		put(';');
+		put(' ');
+		if(length + comment.size() <= size)
+			std::copy(comment.begin(), comment.end(), buffer + length);
+		length += comment.size();
 	}
-
-	s << '\n';
-
-	return s.str();
+	
+	put('\n');
+	return length;
 }
 
 }
 }
-
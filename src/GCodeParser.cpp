@@ -0,0 +1,408 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * GCodeParser.cpp
+ */
+
+#include "cxxcam/GCodeParser.h"
+#include "cxxcam/Error.h"
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include "MappedFile.h"
+#include "ParseNumber.h"
+#include "Parallel.h"
+
+namespace cxxcam
+{
+namespace gcode
+{
+
+std::size_t program_t::size() const
+{
+	return lines.size();
+}
+bool program_t::empty() const
+{
+	return lines.empty();
+}
+void program_t::clear()
+{
+	words.clear();
+	lines.clear();
+	comments.clear();
+}
+
+Line program_t::line(std::size_t i) const
+{
+	auto& l = lines.at(i);
+	
+	Line result;
+	for(auto w = l.first; w < l.first + l.count; ++w)
+	{
+		auto& word = words[w];
+		if(word.comment != no_comment)
+			result += Word(word.code, word.value, comments[word.comment]);
+		else
+			result += Word(word.code, word.value);
+	}
+	if(l.comment != no_comment)
+		result.Comment(comments[l.comment]);
+	return result;
+}
+
+namespace
+{
+
+// Word::Code by letter; -1 for letters that are not words.
+const signed char letter_codes[26] = {
+	Word::A, Word::B, Word::C, Word::D, -1, Word::F, Word::G, Word::H, Word::I,
+	Word::J, Word::K, Word::L, Word::M, -1, -1, Word::P, Word::Q, Word::R,
+	Word::S, Word::T, Word::U, Word::V, Word::W, Word::X, Word::Y, Word::Z
+};
+
+bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Lines per chunk are counted from 1 until the chunks are joined.
+struct parse_failure
+{
+	std::size_t number;
+	std::string what;
+};
+
+[[noreturn]] void fail(std::size_t number, const std::string& what)
+{
+	throw parse_failure{number, what};
+}
+
+error parse_error(std::size_t number, const std::string& what)
+{
+	return error("G-code line " + std::to_string(number) + ": " + what);
+}
+
+// Smallest chunk of text parsed on its own thread.
+const std::size_t parse_chunk = 1 << 20;
+
+void add_comment(program_t& program, std::uint32_t& comment, const char* begin, const char* end)
+{
+	if(comment == program_t::no_comment)
+	{
+		comment = program.comments.size();
+		program.comments.emplace_back(begin, end);
+	}
+	else
+	{
+		auto& s = program.comments[comment];
+		s += ' ';
+		s.append(begin, end);
+	}
+}
+
+void parse_line(const char* p, const char* end, std::size_t number, program_t& program)
+{
+	program_t::line_t line{program.words.size(), 0, number, program_t::no_comment};
+	
+	while(p != end)
+	{
+		auto c = *p;
+		if(is_space(c))
+		{
+			++p;
+			continue;
+		}
+		
+		if(c == '(')
+		{
+			auto close = static_cast<const char*>(std::memchr(p, ')', end - p));
+			if(!close)
+				fail(number, "unterminated comment");
+			if(line.count > 0)
+				add_comment(program, program.words.back().comment, p + 1, close);
+			else
+				add_comment(program, line.comment, p + 1, close);
+			p = close + 1;
+			continue;
+		}
+		if(c == ';')
+		{
+			auto begin = p + 1;
+			while(begin != end && is_space(*begin))
+				++begin;
+			while(end != begin && is_space(end[-1]))
+				--end;
+			add_comment(program, line.comment, begin, end);
+			break;
+		}
+		if(c == '/' || c == '%')
+		{
+			++p;
+			continue;
+		}
+		
+		auto letter = (c | 0x20) - 'a';
+		if(letter < 0 || letter >= 26)
+			fail(number, std::string("unexpected '") + c + "'");
+		
+		for(++p; p != end && is_space(*p); ++p)
+			;
+		double value;
+		if(!parse_number(p, end, value))
+			fail(number, std::string("expected number after '") + c + "'");
+		
+		if(letter == 'n' - 'a')
+			continue;
+		auto code = letter_codes[letter];
+		if(code < 0)
+			fail(number, std::string("unsupported word '") + c + "'");
+		
+		program.words.push_back({static_cast<Word::Code>(code), program_t::no_comment, value});
+		++line.count;
+	}
+	
+	if(line.count > 0 || line.comment != program_t::no_comment)
+		program.lines.push_back(line);
+}
+
+/*
+ * Parses the lines of [data, end), numbered from 1.
+ * Returns the number of source lines.
+ */
+std::size_t parse_lines(const char* data, const char* end, program_t& program)
+{
+	std::size_t number = 0;
+	for(auto p = data; p < end; )
+	{
+		++number;
+		auto eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if(!eol)
+			eol = end;
+		parse_line(p, eol, number, program);
+		p = eol + 1;
+	}
+	return number;
+}
+
+/*
+ * Appends part to program, offsetting its word, comment and source line
+ * references.
+ */
+void join(program_t& part, std::size_t source_lines, program_t& program, std::size_t words, std::size_t lines, std::size_t comments)
+{
+	auto comment = [&](std::uint32_t c) -> std::uint32_t
+	{
+		return c == program_t::no_comment ? c : c + comments;
+	};
+	
+	auto w = program.words.begin() + words;
+	for(auto& word : part.words)
+		*w++ = {word.code, comment(word.comment), word.value};
+	
+	auto l = program.lines.begin() + lines;
+	for(auto& line : part.lines)
+		*l++ = {line.first + words, line.count, line.number + source_lines, comment(line.comment)};
+	
+	std::move(part.comments.begin(), part.comments.end(), program.comments.begin() + comments);
+}
+
+}
+
+program_t parse(const char* data, std::size_t size, unsigned threads)
+{
+	auto end = data + size;
+	threads = parallel::thread_count(threads);
+	if(threads < 2 || size < 2 * parse_chunk)
+	{
+		program_t program;
+		try
+		{
+			parse_lines(data, end, program);
+		}
+		catch(const parse_failure& f)
+		{
+			throw parse_error(f.number, f.what);
+		}
+		return program;
+	}
+	
+	// Chunks end after a newline; several per thread to balance the load.
+	auto target = std::max(parse_chunk, size / (threads * 4));
+	std::vector<const char*> bounds{data};
+	while(static_cast<std::size_t>(end - bounds.back()) > target)
+	{
+		auto next = bounds.back() + target;
+		auto eol = static_cast<const char*>(std::memchr(next, '\n', end - next));
+		if(!eol || eol + 1 == end)
+			break;
+		bounds.push_back(eol + 1);
+	}
+	bounds.push_back(end);
+	auto chunks = bounds.size() - 1;
+	
+	std::vector<program_t> parts(chunks);
+	std::vector<std::size_t> source_lines(chunks);
+	std::vector<parse_failure> failures(chunks);
+	std::vector<char> failed(chunks, 0);
+	parallel::for_blocks(chunks, 1, threads, [&](std::size_t first, std::size_t last)
+	{
+		for(auto c = first; c < last; ++c)
+		{
+			try
+			{
+				source_lines[c] = parse_lines(bounds[c], bounds[c+1], parts[c]);
+			}
+			catch(const parse_failure& f)
+			{
+				failures[c] = f;
+				failed[c] = 1;
+			}
+		}
+	});
+	
+	// Offsets of each part in the joined program.
+	std::vector<std::size_t> words(chunks + 1), lines(chunks + 1), comments(chunks + 1), numbers(chunks + 1);
+	for(std::size_t c = 0; c < chunks; ++c)
+	{
+		if(failed[c])
+			throw parse_error(numbers[c] + failures[c].number, failures[c].what);
+		
+		words[c+1] = words[c] + parts[c].words.size();
+		lines[c+1] = lines[c] + parts[c].lines.size();
+		comments[c+1] = comments[c] + parts[c].comments.size();
+		numbers[c+1] = numbers[c] + source_lines[c];
+	}
+	
+	program_t program;
+	program.words.resize(words.back());
+	program.lines.resize(lines.back());
+	program.comments.resize(comments.back());
+	parallel::for_blocks(chunks, 1, threads, [&](std::size_t first, std::size_t last)
+	{
+		for(auto c = first; c < last; ++c)
+			join(parts[c], numbers[c], program, words[c], lines[c], comments[c]);
+	});
+	return program;
+}
+modal_t::modal_t()
+ : absolute(true), metric(true)
+{
+}
+
+void modal_t::apply(const program_t& program, std::size_t i)
+{
+	auto& line = program.lines[i];
+	auto first = program.words.data() + line.first;
+	apply(first, first + line.count);
+}
+void modal_t::apply(const program_t::word_t* first, const program_t::word_t* last)
+{
+	// Modes set on a line apply to the words of that line.
+	for(auto word = first; word != last; ++word)
+	{
+		if(word->code != Word::G)
+			continue;
+		if(word->value == 90)
+			absolute = true;
+		else if(word->value == 91)
+			absolute = false;
+		else if(word->value == 20)
+			metric = false;
+		else if(word->value == 21)
+			metric = true;
+	}
+	
+	auto scale = metric ? 1.0 : 25.4;
+	auto length = [&](units::length& axis, double value)
+	{
+		auto v = units::length{value * scale * units::millimeters};
+		axis = absolute ? v : axis + v;
+	};
+	auto angle = [&](units::plane_angle& axis, double value)
+	{
+		auto v = units::plane_angle{value * units::degrees};
+		axis = absolute ? v : axis + v;
+	};
+	
+	for(auto word = first; word != last; ++word)
+	{
+		switch(word->code)
+		{
+			case Word::X:
+				length(position.X, word->value);
+				break;
+			case Word::Y:
+				length(position.Y, word->value);
+				break;
+			case Word::Z:
+				length(position.Z, word->value);
+				break;
+			case Word::U:
+				length(position.U, word->value);
+				break;
+			case Word::V:
+				length(position.V, word->value);
+				break;
+			case Word::W:
+				length(position.W, word->value);
+				break;
+			case Word::A:
+				angle(position.A, word->value);
+				break;
+			case Word::B:
+				angle(position.B, word->value);
+				break;
+			case Word::C:
+				angle(position.C, word->value);
+				break;
+			case Word::F:
+				feed = units::velocity{word->value * scale * units::millimeters_per_minute};
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+std::vector<Position> resolve(const program_t& program, modal_t state)
+{
+	std::vector<Position> positions;
+	positions.reserve(program.size());
+	for(std::size_t i = 0; i < program.size(); ++i)
+	{
+		state.apply(program, i);
+		positions.push_back(state.position);
+	}
+	return positions;
+}
+
+program_t parse(const std::string& text, unsigned threads)
+{
+	return parse(text.data(), text.size(), threads);
+}
+
+program_t parse_file(const std::string& filename, unsigned threads)
+{
+	mapped_file file(filename);
+	return parse(file.data, file.size, threads);
+}
+
+}
+}
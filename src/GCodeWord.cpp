@@ -23,10 +23,12 @@
  */
 
 #include "cxxcam/GCodeWord.h"
-#include <sstream>
 #include <ostream>
 #include <stdexcept>
-#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
 
 namespace cxxcam
 {
@@ -57,87 +59,147 @@ void Word::Comment(const std::string& comment)
 {
 	m_Comment = comment;
 }
-std::string Word::Comment() const
+const std::string& Word::Comment() const
 {
 	return m_Comment;
 }
 
-std::string to_string(Word::Code code)
+namespace
 {
-	switch(code)
-	{
-		case Word::A:
-			return "A";
-		case Word::B:
-			return "B";
-		case Word::C:
-			return "C";
-		case Word::D:
-			return "D";
-		case Word::F:
-			return "F";
-		case Word::G:
-			return "G";
-		case Word::H:
-			return "H";
-		case Word::I:
-			return "I";
-		case Word::J:
-			return "J";
-		case Word::K:
-			return "K";
-		case Word::L:
-			return "L";
-		case Word::M:
-			return "M";
-		case Word::P:
-			return "P";
-		case Word::Q:
-			return "Q";
-		case Word::R:
-			return "R";
-		case Word::S:
-			return "S";
-		case Word::T:
-			return "T";
-		case Word::U:
-			return "U";
-		case Word::V:
-			return "V";
-		case Word::W:
-			return "W";
-		case Word::X:
-			return "X";
-		case Word::Y:
-			return "Y";
-		case Word::Z:
-			return "Z";
-	}
 
-	throw std::logic_error("Unknown GCode word.");
+// Indexed by Word::Code.
+const char codes[] = "ABCDFGHIJKLMPQRSTUVWXYZ";
+
+// Longest "%.6f" of a double (sign, 309 integer digits, point, 6 decimals).
+const std::size_t number_size = 320;
+
+/*
+ * Trims trailing zeros and then a trailing point from fixed notation.
+ */
+std::size_t trim(const char* s, std::size_t n)
+{
+	while(n > 0 && s[n-1] == '0')
+		--n;
+	if(n > 0 && s[n-1] == '.')
+		--n;
+	return n;
 }
 
-std::ostream& operator<<(std::ostream& os, const Word& word)
+/*
+ * Value in fixed notation to six decimal places with trailing zeros
+ * trimmed, as written by iostreams.
+ * Values below 2^52 micro units are rounded exactly (half to even) from
+ * the value and the error term of the scaled product; larger and non
+ * finite values use snprintf.
+ */
+std::size_t format_number(char* out, double value)
 {
-	os << to_string(word);
+	const double scale = 1e6;
+	const double limit = 4503599627370496.0 / scale;	// 2^52 / scale
+	
+	if(!(std::abs(value) < limit))
 	{
-		std::ostringstream ss;
-		ss << std::fixed << std::setprecision(6) << word.Value();
-		auto s = ss.str();
-		
-		s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-		if(s.back() == '.')
-			s.pop_back();
-		os << s;
+		auto n = std::snprintf(out, number_size, "%.6f", value);
+		return trim(out, n);
 	}
-	auto comment = word.Comment();
+	
+	char* p = out;
+	if(std::signbit(value))
+	{
+		*p++ = '-';
+		value = -value;
+	}
+	
+	// Dekker product; scale fits in 26 bits so only the value is split.
+	auto product = value * scale;
+	auto c = 134217729.0 * value;
+	auto high = c - (c - value);
+	auto low = value - high;
+	auto error = (high * scale - product) + low * scale;
+	
+	auto whole = std::floor(product);
+	auto above = ((product - whole) - 0.5) + error;
+	auto units = static_cast<std::uint64_t>(whole);
+	if(above > 0 || (above == 0 && (units & 1)))
+		++units;
+	
+	auto integer = units / 1000000;
+	auto fraction = static_cast<unsigned>(units % 1000000);
+	
+	char digits[20];
+	std::size_t n = 0;
+	do
+	{
+		digits[n++] = '0' + integer % 10;
+		integer /= 10;
+	}
+	while(integer);
+	while(n)
+		*p++ = digits[--n];
+	
+	if(fraction)
+	{
+		*p++ = '.';
+		for(unsigned d = 100000; fraction; d /= 10)
+		{
+			*p++ = '0' + fraction / d;
+			fraction %= d;
+		}
+	}
+	return p - out;
+}
 
-	if(!comment.empty())
-		os << " (" << comment << ")";
+}
 
-	return os;
+char to_char(Word::Code code)
+{
+	if(code < Word::A || code > Word::Z)
+		throw std::logic_error("Unknown GCode word.");
+	return codes[code];
 }
 
+std::string to_string(Word::Code code)
+{
+	return std::string(1, to_char(code));
 }
+
+std::size_t format(char* buffer, std::size_t size, const Word& word)
+{
+	char number[number_size];
+	auto code = to_char(word);
+	auto n = format_number(number, word.Value());
+	auto& comment = word.Comment();
+	
+	auto length = 1 + n;
+	if(!comment.empty())
+		length += comment.size() + 3;
+	if(length > size)
+		return length;
+	
+	*buffer++ = code;
+	buffer = std::copy(number, number + n, buffer);
+	if(!comment.empty())
+	{
+		*buffer++ = ' ';
+		*buffer++ = '(';
+		buffer = std::copy(comment.begin(), comment.end(), buffer);
+		*buffer++ = ')';
+	}
+	return length;
+}
+
+std::ostream& operator<<(std::ostream& os, const Word& word)
+{
+	char buffer[128];
+	auto n = format(buffer, sizeof(buffer), word);
+	if(n <= sizeof(buffer))
+		return os.write(buffer, n);
+	
+	// Long comment.
+	std::string s(n, 0);
+	format(&s[0], n, word);
+	return os << s;
 }
 
+}
+}
@@ -0,0 +1,135 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * GCodeWriter.cpp
+ */
+
+#include "cxxcam/GCodeWriter.h"
+#include "cxxcam/Error.h"
+#include <ostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+namespace cxxcam
+{
+namespace gcode
+{
+
+Writer::Writer(int fd, std::size_t buffer_size)
+ : m_Buffer(std::max<std::size_t>(buffer_size, 1)), m_Used(0), m_Fd(fd), m_Stream(nullptr), m_Bytes(0), m_Lines(0)
+{
+}
+Writer::Writer(std::ostream& os, std::size_t buffer_size)
+ : m_Buffer(std::max<std::size_t>(buffer_size, 1)), m_Used(0), m_Fd(-1), m_Stream(&os), m_Bytes(0), m_Lines(0)
+{
+}
+Writer::~Writer()
+{
+	try
+	{
+		Flush();
+	}
+	catch(const error&)
+	{
+	}
+}
+
+void Writer::Write(const char* data, std::size_t size)
+{
+	if(m_Stream)
+	{
+		if(!m_Stream->write(data, size))
+			throw error("Unable to write G-code to stream.");
+		return;
+	}
+	
+	while(size > 0)
+	{
+		auto n = ::write(m_Fd, data, size);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			throw error(std::string("Unable to write G-code: ") + std::strerror(errno));
+		}
+		data += n;
+		size -= n;
+	}
+}
+
+void Writer::Write(const Line& line)
+{
+	auto available = m_Buffer.size() - m_Used;
+	auto n = format(m_Buffer.data() + m_Used, available, line);
+	if(n > available)
+	{
+		Flush();
+		if(n > m_Buffer.size())
+		{
+			// Longer than the buffer; written directly.
+			std::vector<char> s(n);
+			format(s.data(), n, line);
+			Write(s.data(), n);
+		}
+		else
+		{
+			format(m_Buffer.data(), n, line);
+			m_Used = n;
+		}
+	}
+	else
+	{
+		m_Used += n;
+	}
+	
+	m_Bytes += n;
+	++m_Lines;
+}
+Writer& Writer::operator<<(const Line& line)
+{
+	Write(line);
+	return *this;
+}
+
+void Writer::Flush()
+{
+	if(m_Used == 0)
+		return;
+	
+	// The buffer is released even if the write fails.
+	auto used = m_Used;
+	m_Used = 0;
+	Write(m_Buffer.data(), used);
+	if(m_Stream && !m_Stream->flush())
+		throw error("Unable to write G-code to stream.");
+}
+
+std::uint64_t Writer::Bytes() const
+{
+	return m_Bytes;
+}
+std::uint64_t Writer::Lines() const
+{
+	return m_Lines;
+}
+
+}
+}
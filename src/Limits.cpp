@@ -25,32 +25,209 @@
 #include "cxxcam/Limits.h"
 #include "cxxcam/Error.h"
 #include "cxxcam/Position.h"
+#include "cxxcam/Path.h"
+#include "cxxcam/Bbox.h"
 #include <boost/units/cmath.hpp>
 #include <algorithm>
+#include <cmath>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace cxxcam
 {
 namespace limits
 {
 
+namespace
+{
+
+const std::size_t axis_count = 9;
+
+/*
+ * Axis values of a position in SI units, indexed by Axis::Type.
+ */
+void axis_values(const Position& p, double v[axis_count])
+{
+	v[0] = p.X.value();
+	v[1] = p.Y.value();
+	v[2] = p.Z.value();
+	v[3] = p.A.value();
+	v[4] = p.B.value();
+	v[5] = p.C.value();
+	v[6] = p.U.value();
+	v[7] = p.V.value();
+	v[8] = p.W.value();
+}
+
+Axis::Type axis_type(std::size_t i)
+{
+	return static_cast<Axis::Type>(i);
+}
+
+/*
+ * Clears (to NaN) the XYZ limits that the greatest travel hi stays within.
+ * Returns false if no axis exceeds its limit.
+ */
+bool prune_limits(const double hi[3], double limit[3])
+{
+	bool outside = false;
+	for(std::size_t a = 0; a < 3; ++a)
+	{
+		if(hi[a] > limit[a])
+			outside = true;
+		else
+			limit[a] = std::numeric_limits<double>::quiet_NaN();
+	}
+	return outside;
+}
+
+/*
+ * Appends the violations of step i; NaN limits are never exceeded.
+ */
+void travel_report(std::size_t i, const double v[3], const double limit[3], std::vector<travel_violation>& violations)
+{
+	for(std::size_t a = 0; a < 3; ++a)
+	{
+		if(v[a] > limit[a])
+			violations.push_back({i, axis_type(a), units::length::from_value(v[a])});
+	}
+}
+
+/*
+ * Compares a vector of steps of each axis against the limits at once,
+ * reporting individual steps only for lanes with a violation.
+ */
+void travel_scan(const double* x, const double* y, const double* z, std::size_t n, const double limit[3], std::vector<travel_violation>& violations)
+{
+	auto report = [&](std::size_t i)
+	{
+		double v[3] = {x[i], y[i], z[i]};
+		travel_report(i, v, limit, violations);
+	};
+	
+	std::size_t i = 0;
+#if defined(__AVX__)
+	auto lx = _mm256_set1_pd(limit[0]);
+	auto ly = _mm256_set1_pd(limit[1]);
+	auto lz = _mm256_set1_pd(limit[2]);
+	for(; i + 4 <= n; i += 4)
+	{
+		auto gt = _mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(x + i), lx, _CMP_GT_OQ),
+		          _mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(y + i), ly, _CMP_GT_OQ),
+		                       _mm256_cmp_pd(_mm256_loadu_pd(z + i), lz, _CMP_GT_OQ)));
+		auto mask = _mm256_movemask_pd(gt);
+		for(int k = 0; mask && k < 4; ++k)
+		{
+			if(mask & (1 << k))
+				report(i + k);
+		}
+	}
+#elif defined(__SSE2__)
+	auto lx = _mm_set1_pd(limit[0]);
+	auto ly = _mm_set1_pd(limit[1]);
+	auto lz = _mm_set1_pd(limit[2]);
+	for(; i + 2 <= n; i += 2)
+	{
+		auto gt = _mm_or_pd(_mm_cmpgt_pd(_mm_loadu_pd(x + i), lx),
+		          _mm_or_pd(_mm_cmpgt_pd(_mm_loadu_pd(y + i), ly),
+		                    _mm_cmpgt_pd(_mm_loadu_pd(z + i), lz)));
+		auto mask = _mm_movemask_pd(gt);
+		for(int k = 0; mask && k < 2; ++k)
+		{
+			if(mask & (1 << k))
+				report(i + k);
+		}
+	}
+#endif
+	for(; i < n; ++i)
+		report(i);
+}
+
+}
+
 void Travel::SetLimit(Axis::Type axis, units::length limit)
 {
-	m_Limits[axis] = limit;
+	m_Limits.set(axis, limit);
 }
 void Travel::Validate(Axis::Type axis, units::length travel) const
 {
-	auto it = m_Limits.find(axis);
-	if(it != m_Limits.end())
+	if(m_Limits.has(axis))
 	{
-		if(travel > it->second)
+		if(travel > m_Limits.get(axis))
 			throw error("Travel outside specified limit for axis");
 	}
 }
+void Travel::Validate(const std::vector<Position>& positions) const
+{
+	// Unset limits are NaN and never exceeded.
+	double limit[axis_count];
+	for(std::size_t i = 0; i < axis_count; ++i)
+		limit[i] = is_linear(axis_type(i)) ? m_Limits.get(axis_type(i)).value() : std::numeric_limits<double>::quiet_NaN();
+	
+	for(auto& position : positions)
+	{
+		double v[axis_count];
+		axis_values(position, v);
+		for(std::size_t i = 0; i < axis_count; ++i)
+		{
+			if(v[i] > limit[i])
+				throw error("Travel outside specified limit for axis");
+		}
+	}
+}
+std::vector<travel_violation> Travel::Violations(const path::path_t& path) const
+{
+	std::vector<travel_violation> violations;
+	if(path.path.empty())
+		return violations;
+	
+	double limit[3];
+	for(std::size_t a = 0; a < 3; ++a)
+		limit[a] = m_Limits.get(axis_type(a)).value();
+	
+	auto& p0 = path.path.front().position;
+	double hi[3] = {p0.x.value(), p0.y.value(), p0.z.value()};
+	for(auto& step : path.path)
+	{
+		hi[0] = std::max(hi[0], step.position.x.value());
+		hi[1] = std::max(hi[1], step.position.y.value());
+		hi[2] = std::max(hi[2], step.position.z.value());
+	}
+	if(!prune_limits(hi, limit))
+		return violations;
+	
+	for(std::size_t i = 0; i < path.path.size(); ++i)
+	{
+		auto& p = path.path[i].position;
+		double v[3] = {p.x.value(), p.y.value(), p.z.value()};
+		travel_report(i, v, limit, violations);
+	}
+	return violations;
+}
+std::vector<travel_violation> Travel::Violations(const path::path_soa& path) const
+{
+	std::vector<travel_violation> violations;
+	auto n = path.size();
+	if(n == 0)
+		return violations;
+	
+	double limit[3];
+	for(std::size_t a = 0; a < 3; ++a)
+		limit[a] = m_Limits.get(axis_type(a)).value();
+	
+	auto box = construct(path.x.data(), path.y.data(), path.z.data(), n);
+	double hi[3] = {box.max.x.value(), box.max.y.value(), box.max.z.value()};
+	if(!prune_limits(hi, limit))
+		return violations;
+	
+	travel_scan(path.x.data(), path.y.data(), path.z.data(), n, limit, violations);
+	return violations;
+}
 units::length Travel::MaxTravel(Axis::Type axis) const
 {
-	auto it = m_Limits.find(axis);
-	if(it != m_Limits.end())
-		return it->second;
+	if(m_Limits.has(axis))
+		return m_Limits.get(axis);
 	
 	return {};
 }
@@ -63,23 +240,22 @@ void FeedRate::Set(Axis::Type axis, units::velocity limit)
 {
 	if(!is_linear(axis))
 		throw error("Cannot set linear velocity on angular axis.");
-	m_Linear[axis] = limit;
+	m_Linear.set(axis, limit);
 }
 void FeedRate::Set(Axis::Type axis, units::angular_velocity limit)
 {
 	if(is_linear(axis))
 		throw error("Cannot set angular velocity on linear axis.");
-	m_Angular[axis] = limit;
+	m_Angular.set(axis, limit);
 }
 void FeedRate::Validate(Axis::Type axis, units::velocity rate) const
 {
 	if(!is_linear(axis))
 		throw error("Attempt to validate linear velocity on angular axis.");
 	
-	auto it = m_Linear.find(axis);
-	if(it != m_Linear.end())
+	if(m_Linear.has(axis))
 	{
-		if(rate > it->second)
+		if(rate > m_Linear.get(axis))
 			throw error("FeedRate outside specified limit for axis");
 	}
 	
@@ -91,21 +267,57 @@ void FeedRate::Validate(Axis::Type axis, units::angular_velocity rate) const
 	if(is_linear(axis))
 		throw error("Attempt to validate angular velocity on linear axis.");
 	
-	auto it = m_Angular.find(axis);
-	if(it != m_Angular.end())
+	if(m_Angular.has(axis))
 	{
-		if(rate > it->second)
+		if(rate > m_Angular.get(axis))
 			throw error("FeedRate outside specified limit for axis");
 	}
 }
+void FeedRate::Validate(const std::vector<Position>& positions, units::velocity rate) const
+{
+	// Unset limits are NaN and never exceeded.
+	double limit[axis_count];
+	bool linear[axis_count];
+	for(std::size_t i = 0; i < axis_count; ++i)
+	{
+		auto axis = axis_type(i);
+		linear[i] = is_linear(axis);
+		limit[i] = linear[i] ? m_Linear.get(axis).value() : m_Angular.get(axis).value();
+	}
+	auto global = m_Global.value();
+	
+	double begin[axis_count];
+	double end[axis_count];
+	for(std::size_t n = 1; n < positions.size(); ++n)
+	{
+		axis_values(positions[n-1], begin);
+		axis_values(positions[n], end);
+		
+		auto dx = end[0] - begin[0];
+		auto dy = end[1] - begin[1];
+		auto dz = end[2] - begin[2];
+		auto length = std::sqrt(dx*dx + dy*dy + dz*dz);
+		if(length == 0)
+			continue;
+		
+		auto scale = rate.value() / length;
+		for(std::size_t i = 0; i < axis_count; ++i)
+		{
+			auto axis_rate = std::abs(end[i] - begin[i]) * scale;
+			if(axis_rate > limit[i])
+				throw error("FeedRate outside specified limit for axis");
+			if(linear[i] && axis_rate > global)
+				throw error("FeedRate outside specified global limit");
+		}
+	}
+}
 units::velocity FeedRate::MaxLinear(Axis::Type axis) const
 {
 	if(!is_linear(axis))
 		throw error("Attempt to get max linear velocity on angular axis.");
-		
-	auto it = m_Linear.find(axis);
-	if(it != m_Linear.end())
-		return it->second;
+	
+	if(m_Linear.has(axis))
+		return m_Linear.get(axis);
 	
 	return m_Global;
 }
@@ -113,14 +325,52 @@ units::angular_velocity FeedRate::MaxAngular(Axis::Type axis) const
 {
 	if(is_linear(axis))
 		throw error("Attempt to get max angular velocity on linear axis.");
-		
-	auto it = m_Angular.find(axis);
-	if(it != m_Angular.end())
-		return it->second;
+	
+	if(m_Angular.has(axis))
+		return m_Angular.get(axis);
 	
 	return {};
 }
 
+namespace
+{
+
+/*
+ * Time for each axis to move independently at its rate; the slowest axis
+ * determines the duration.
+ */
+double rapid_duration(const double begin[axis_count], const double end[axis_count], const double rate[axis_count])
+{
+	double duration = 0;
+	for(std::size_t i = 0; i < axis_count; ++i)
+	{
+		auto distance = std::abs(end[i] - begin[i]);
+		if(rate[i] == 0)
+		{
+			if(distance != 0)
+			{
+				if(is_linear(axis_type(i)))
+					throw error("Linear movement on axis with zero velocity will take infinite time.");
+				throw error("Angular movement on axis with zero velocity will take infinite time.");
+			}
+			continue;
+		}
+		duration = std::max(duration, distance / rate[i]);
+	}
+	return duration;
+}
+
+void rapid_rates(const Rapids& rapids, double rate[axis_count])
+{
+	for(std::size_t i = 0; i < axis_count; ++i)
+	{
+		auto axis = axis_type(i);
+		rate[i] = is_linear(axis) ? rapids.LinearVelocity(axis).value() : rapids.AngularVelocity(axis).value();
+	}
+}
+
+}
+
 void Rapids::SetGlobal(units::velocity limit)
 {
 	m_Global = limit;
@@ -129,76 +379,48 @@ void Rapids::Set(Axis::Type axis, units::velocity limit)
 {
 	if(!is_linear(axis))
 		throw error("Cannot set linear velocity on angular axis.");
-	m_Linear[axis] = limit;
+	m_Linear.set(axis, limit);
 }
 void Rapids::Set(Axis::Type axis, units::angular_velocity limit)
 {
 	if(is_linear(axis))
 		throw error("Cannot set angular velocity on linear axis.");
-	m_Angular[axis] = limit;
+	m_Angular.set(axis, limit);
 }
 units::time Rapids::Duration(const Position& begin, const Position& end) const
 {
-	static const units::length zero;
-	static const units::velocity velocity_zero;
-	static const units::plane_angle angular_zero;
-	static const units::angular_velocity angular_velocity_zero;
-
-	auto linear_axis_time = [this](units::length begin, units::length end, Axis::Type axis) -> units::time
-	{
-		if(!is_linear(axis))
-			throw std::logic_error("Attempt to calculate linear time on angular axis.");
-		
-		auto distance = abs(end - begin);
-		auto velocity = LinearVelocity(axis);
-		
-		if(velocity == velocity_zero)
-		{
-			if(distance != zero)
-				throw error("Linear movement on axis with zero velocity will take infinite time.");
-			
-			return {};
-		}
-		return distance / velocity;
-	};
-	auto angular_axis_time = [this](units::plane_angle begin, units::plane_angle end, Axis::Type axis) -> units::time
-	{
-		if(is_linear(axis))
-			throw std::logic_error("Attempt to calculate angular time on linear axis.");
-		
-		auto distance = abs(end - begin);
-		auto velocity = AngularVelocity(axis);
-		if(velocity == angular_velocity_zero)
-		{
-			if(distance != angular_zero)
-				throw error("Angular movement on axis with zero velocity will take infinite time.");
-			
-			return {};
-		}
-		return distance / velocity;
-	};
+	double rate[axis_count];
+	rapid_rates(*this, rate);
 	
-	return std::max(
+	double b[axis_count];
+	double e[axis_count];
+	axis_values(begin, b);
+	axis_values(end, e);
+	return units::time::from_value(rapid_duration(b, e, rate));
+}
+units::time Rapids::Duration(const std::vector<Position>& positions) const
+{
+	double rate[axis_count];
+	rapid_rates(*this, rate);
+	
+	double duration = 0;
+	double begin[axis_count];
+	double end[axis_count];
+	for(std::size_t n = 1; n < positions.size(); ++n)
 	{
-		linear_axis_time(begin.X, end.X, Axis::Type::X),
-		linear_axis_time(begin.Y, end.Y, Axis::Type::Y),
-		linear_axis_time(begin.Z, end.Z, Axis::Type::Z),
-		angular_axis_time(begin.A, end.A, Axis::Type::A),
-		angular_axis_time(begin.B, end.B, Axis::Type::B),
-		angular_axis_time(begin.C, end.C, Axis::Type::C),
-		linear_axis_time(begin.U, end.U, Axis::Type::U),
-		linear_axis_time(begin.V, end.V, Axis::Type::V),
-		linear_axis_time(begin.W, end.W, Axis::Type::W)
-	});
+		axis_values(positions[n-1], begin);
+		axis_values(positions[n], end);
+		duration += rapid_duration(begin, end, rate);
+	}
+	return units::time::from_value(duration);
 }
 units::velocity Rapids::LinearVelocity(Axis::Type axis) const
 {
 	if(!is_linear(axis))
 		throw error("Attempt to get max linear velocity on angular axis.");
 	
-	auto it = m_Linear.find(axis);
-	if(it != m_Linear.end())
-		return it->second;
+	if(m_Linear.has(axis))
+		return m_Linear.get(axis);
 	
 	return m_Global;
 }
@@ -207,24 +429,93 @@ units::angular_velocity Rapids::AngularVelocity(Axis::Type axis) const
 	if(is_linear(axis))
 		throw error("Attempt to get max angular velocity on linear axis.");
 	
-	auto it = m_Angular.find(axis);
-	if(it != m_Angular.end())
-		return it->second;
+	if(m_Angular.has(axis))
+		return m_Angular.get(axis);
 	
 	return {};
 }
 
+namespace
+{
+
+template <typename T>
+T unbounded(const axis_table<T>& table, Axis::Type axis)
+{
+	if(table.has(axis))
+		return table.get(axis);
+	return T::from_value(std::numeric_limits<double>::infinity());
+}
+
+}
+
+void Acceleration::Set(Axis::Type axis, units::acceleration limit)
+{
+	if(!is_linear(axis))
+		throw error("Cannot set linear acceleration on angular axis.");
+	if(!(limit > units::acceleration{}))
+		throw error("Acceleration limit must be positive.");
+	m_Linear.set(axis, limit);
+}
+void Acceleration::Set(Axis::Type axis, units::angular_acceleration limit)
+{
+	if(is_linear(axis))
+		throw error("Cannot set angular acceleration on linear axis.");
+	if(!(limit > units::angular_acceleration{}))
+		throw error("Acceleration limit must be positive.");
+	m_Angular.set(axis, limit);
+}
+void Acceleration::SetJerk(Axis::Type axis, units::jerk limit)
+{
+	if(!is_linear(axis))
+		throw error("Cannot set linear jerk on angular axis.");
+	if(!(limit > units::jerk{}))
+		throw error("Jerk limit must be positive.");
+	m_LinearJerk.set(axis, limit);
+}
+void Acceleration::SetJerk(Axis::Type axis, units::angular_jerk limit)
+{
+	if(is_linear(axis))
+		throw error("Cannot set angular jerk on linear axis.");
+	if(!(limit > units::angular_jerk{}))
+		throw error("Jerk limit must be positive.");
+	m_AngularJerk.set(axis, limit);
+}
+units::acceleration Acceleration::MaxLinear(Axis::Type axis) const
+{
+	if(!is_linear(axis))
+		throw error("Attempt to get max linear acceleration on angular axis.");
+	return unbounded(m_Linear, axis);
+}
+units::angular_acceleration Acceleration::MaxAngular(Axis::Type axis) const
+{
+	if(is_linear(axis))
+		throw error("Attempt to get max angular acceleration on linear axis.");
+	return unbounded(m_Angular, axis);
+}
+units::jerk Acceleration::MaxLinearJerk(Axis::Type axis) const
+{
+	if(!is_linear(axis))
+		throw error("Attempt to get max linear jerk on angular axis.");
+	return unbounded(m_LinearJerk, axis);
+}
+units::angular_jerk Acceleration::MaxAngularJerk(Axis::Type axis) const
+{
+	if(is_linear(axis))
+		throw error("Attempt to get max angular jerk on linear axis.");
+	return unbounded(m_AngularJerk, axis);
+}
+
 auto AvailableAxes::begin() const -> const_iterator
 {
-	return axes.begin();
+	return m_Axes.data();
 }
 auto AvailableAxes::end() const -> const_iterator
 {
-	return axes.end();
+	return m_Axes.data() + m_Count;
 }
 
 AvailableAxes::AvailableAxes()
- : axes({
+ : AvailableAxes({
    Axis::Type::X,
    Axis::Type::Y,
    Axis::Type::Z,
@@ -240,15 +531,21 @@ AvailableAxes::AvailableAxes()
 {
 }
 AvailableAxes::AvailableAxes(std::vector<Axis::Type> axes)
- : axes(axes)
+ : m_Axes(), m_Count(0), m_Mask(0)
 {
+	for(auto axis : axes)
+	{
+		if(Has(axis))
+			throw error("Repeated Axis.");
+		m_Axes[m_Count++] = axis;
+		m_Mask |= axis_mask(axis);
+	}
 }
 void AvailableAxes::Validate(Axis::Type axis) const
 {
-	if(std::find(begin(), end(), axis) == end())
+	if(!Has(axis))
 		throw error("Invalid Axis.");
 }
 
 }
 }
-
@@ -0,0 +1,86 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * MappedFile.h
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+#include "cxxcam/Error.h"
+#include <string>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace cxxcam
+{
+
+/*
+ * Read only mapping of a whole file.
+ * Throws cxxcam::error if the file cannot be opened or mapped.
+ * data is null for an empty file.
+ */
+struct mapped_file
+{
+	int fd;
+	const char* data;
+	std::size_t size;
+	
+	explicit mapped_file(const std::string& filename)
+	 : fd(-1), data(nullptr), size(0)
+	{
+		fd = open(filename.c_str(), O_RDONLY);
+		if(fd < 0)
+			throw error("Unable to open " + filename);
+		
+		struct stat st;
+		if(fstat(fd, &st) != 0)
+		{
+			close(fd);
+			throw error("Unable to read " + filename);
+		}
+		size = st.st_size;
+		if(size == 0)
+			return;
+		
+		auto p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p == MAP_FAILED)
+		{
+			close(fd);
+			throw error("Unable to map " + filename);
+		}
+		data = static_cast<const char*>(p);
+		madvise(p, size, MADV_SEQUENTIAL);
+	}
+	~mapped_file()
+	{
+		if(data)
+			munmap(const_cast<char*>(data), size);
+		close(fd);
+	}
+	
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+};
+
+}
+
+#endif /* MAPPEDFILE_H_ */
@@ -23,12 +23,206 @@
  */
 
 #include "cxxcam/Material.h"
+#include "cxxcam/Error.h"
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <cmath>
+#include <utility>
+#include "MappedFile.h"
+#include "ParseNumber.h"
 
 namespace cxxcam
 {
 namespace material
 {
 
+namespace
+{
+
+/*
+ * FNV-1a over name, a separator and grade; lookups compare the strings so
+ * the table needs no key copies.
+ */
+std::size_t hash(const std::string& name, const std::string& grade)
+{
+	std::uint64_t h = 14695981039346656037ull;
+	auto mix = [&h](const std::string& s)
+	{
+		for(auto c : s)
+			h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	};
+	mix(name);
+	h = (h ^ 0) * 1099511628211ull;
+	mix(grade);
+	return static_cast<std::size_t>(h);
+}
+
+struct field
+{
+	const char* begin;
+	const char* end;
+	
+	bool empty() const
+	{
+		return begin == end;
+	}
+	std::string str() const
+	{
+		return {begin, end};
+	}
+};
+
+field trim(const char* begin, const char* end)
+{
+	while(begin != end && std::isspace(static_cast<unsigned char>(*begin)))
+		++begin;
+	while(end != begin && std::isspace(static_cast<unsigned char>(end[-1])))
+		--end;
+	return {begin, end};
+}
+
+/*
+ * "v" or "low-high"
+ */
+Material::range_t<double> parse_range(const field& f, std::size_t line)
+{
+	auto p = f.begin;
+	double low;
+	auto valid = parse_number(p, f.end, low);
+	auto high = low;
+	if(valid && p != f.end && *p == '-')
+	{
+		++p;
+		valid = parse_number(p, f.end, high);
+	}
+	if(!valid || p != f.end)
+		throw error("Material line " + std::to_string(line) + ": invalid value '" + f.str() + "'");
+	return {low, high};
+}
+
+}
+
+const MaterialTable::id_t MaterialTable::npos = static_cast<id_t>(-1);
+
+auto MaterialTable::Add(const Material& material) -> id_t
+{
+	auto unset = std::numeric_limits<double>::quiet_NaN();
+	surface_t surface;
+	surface.fill(Material::range_t<double>(unset));
+	for(auto& s : material.surface_mmpm)
+		surface[static_cast<std::size_t>(s.first)] = s.second;
+	
+	auto id = Find(material.name, material.grade);
+	if(id == npos)
+	{
+		id = m_Materials.size();
+		m_Index.emplace(hash(material.name, material.grade), id);
+		m_Materials.push_back(material);
+		m_Surface.push_back(surface);
+	}
+	else
+	{
+		m_Materials[id] = material;
+		m_Surface[id] = surface;
+	}
+	return id;
+}
+
+void MaterialTable::Load(const std::string& filename)
+{
+	mapped_file file(filename);
+	Parse(file.data, file.size);
+}
+
+void MaterialTable::Parse(const char* data, std::size_t size)
+{
+	static const Material::Tool tools[] = {Material::Tool::HSS, Material::Tool::Carbide};
+	
+	// Nothing is added unless the whole text parses.
+	std::vector<Material> staged;
+	auto end = data + size;
+	std::size_t line = 0;
+	for(auto p = data; p < end; )
+	{
+		++line;
+		auto eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if(!eol)
+			eol = end;
+		auto text = trim(p, eol);
+		p = eol + 1;
+		
+		if(text.empty() || *text.begin == '#')
+			continue;
+		
+		field fields[6];
+		std::size_t count = 0;
+		for(auto f = text.begin; ; )
+		{
+			auto comma = static_cast<const char*>(std::memchr(f, ',', text.end - f));
+			if(count == 6)
+				throw error("Material line " + std::to_string(line) + ": too many fields");
+			fields[count++] = trim(f, comma ? comma : text.end);
+			if(!comma)
+				break;
+			f = comma + 1;
+		}
+		if(count < 2 || fields[0].empty())
+			throw error("Material line " + std::to_string(line) + ": missing name");
+		
+		Material material;
+		material.name = fields[0].str();
+		material.grade = fields[1].str();
+		if(count > 2 && !fields[2].empty())
+			material.hardness = parse_range(fields[2], line);
+		if(count > 3 && !fields[3].empty())
+			material.machinability = parse_range(fields[3], line);
+		for(std::size_t t = 0; t < tool_count; ++t)
+		{
+			if(count > 4 + t && !fields[4 + t].empty())
+				material.surface_mmpm[tools[t]] = parse_range(fields[4 + t], line);
+		}
+		staged.push_back(std::move(material));
+	}
+	
+	for(auto& material : staged)
+		Add(material);
+}
+
+auto MaterialTable::Find(const std::string& name, const std::string& grade) const -> id_t
+{
+	auto range = m_Index.equal_range(hash(name, grade));
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		auto& material = m_Materials[it->second];
+		if(material.name == name && material.grade == grade)
+			return it->second;
+	}
+	return npos;
+}
+
+const Material& MaterialTable::Get(id_t id) const
+{
+	return m_Materials.at(id);
+}
+
+bool MaterialTable::SurfaceSpeed(id_t id, Material::Tool tool, Material::range_t<double>& surface_mmpm) const
+{
+	if(id >= m_Surface.size())
+		throw error("Material id out of range");
+	auto& surface = m_Surface[id][static_cast<std::size_t>(tool)];
+	if(std::isnan(surface.low))
+		return false;
+	surface_mmpm = surface;
+	return true;
+}
+
+std::size_t MaterialTable::size() const
+{
+	return m_Materials.size();
+}
+
 }
 }
 
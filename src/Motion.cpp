@@ -0,0 +1,536 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Motion.cpp
+ */
+
+#include "cxxcam/Motion.h"
+#include "cxxcam/Error.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace cxxcam
+{
+namespace motion
+{
+
+namespace
+{
+
+const std::size_t axis_count = 9;
+const double infinity = std::numeric_limits<double>::infinity();
+
+void axis_values(const Position& p, double v[axis_count])
+{
+	v[0] = p.X.value();
+	v[1] = p.Y.value();
+	v[2] = p.Z.value();
+	v[3] = p.A.value();
+	v[4] = p.B.value();
+	v[5] = p.C.value();
+	v[6] = p.U.value();
+	v[7] = p.V.value();
+	v[8] = p.W.value();
+}
+
+Axis::Type axis_type(std::size_t i)
+{
+	return static_cast<Axis::Type>(i);
+}
+
+/*
+ * Axis limits in SI values. Unset feed limits are infinite.
+ */
+struct axis_limits
+{
+	double velocity;
+	double acceleration;
+	double jerk;
+};
+
+axis_limits feed_limits(Axis::Type axis, const limits::FeedRate& feed, const limits::Acceleration& acceleration)
+{
+	axis_limits l;
+	if(is_linear(axis))
+	{
+		l.velocity = feed.MaxLinear(axis).value();
+		l.acceleration = acceleration.MaxLinear(axis).value();
+		l.jerk = acceleration.MaxLinearJerk(axis).value();
+	}
+	else
+	{
+		l.velocity = feed.MaxAngular(axis).value();
+		l.acceleration = acceleration.MaxAngular(axis).value();
+		l.jerk = acceleration.MaxAngularJerk(axis).value();
+	}
+	if(!(l.velocity > 0))
+		l.velocity = infinity;
+	return l;
+}
+
+/*
+ * Limits along a path on which the axis moves `ratio` units per unit of path length.
+ */
+void constrain(axis_limits& path, double ratio, const axis_limits& axis)
+{
+	if(!(ratio > 0))
+		return;
+	path.velocity = std::min(path.velocity, axis.velocity / ratio);
+	path.acceleration = std::min(path.acceleration, axis.acceleration / ratio);
+	path.jerk = std::min(path.jerk, axis.jerk / ratio);
+}
+
+axis_limits path_limits(units::velocity feed)
+{
+	if(!(feed > units::velocity{}))
+		throw error("Feed rate must be positive.");
+	return {feed.value(), infinity, infinity};
+}
+
+/*
+ * Limits along a straight move with absolute axis travel d and cartesian length.
+ */
+axis_limits linear_limits(const double d[axis_count], double length, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration)
+{
+	auto path = path_limits(feed);
+	for(std::size_t i = 0; i < axis_count; ++i)
+		constrain(path, d[i] / length, feed_limits(axis_type(i), limits, acceleration));
+	return path;
+}
+
+/*
+ * In plane axes (u, v) and helix axis (w) of an arc.
+ */
+void arc_axes(const path::arc_plan& arc, Axis::Type& u, Axis::Type& v, Axis::Type& w)
+{
+	auto& plane = arc.plane();
+	if(plane.z == 1)
+	{
+		u = Axis::Type::X;
+		v = Axis::Type::Y;
+		w = Axis::Type::Z;
+	}
+	else if(plane.y == 1)
+	{
+		u = Axis::Type::X;
+		v = Axis::Type::Z;
+		w = Axis::Type::Y;
+	}
+	else
+	{
+		u = Axis::Type::Z;
+		v = Axis::Type::Y;
+		w = Axis::Type::X;
+	}
+}
+
+axis_limits arc_limits(const path::arc_plan& arc, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration)
+{
+	auto length = arc.length().value();
+	
+	Axis::Type u;
+	Axis::Type v;
+	Axis::Type w;
+	arc_axes(arc, u, v, w);
+	
+	// The direction of travel rotates through both in plane axes.
+	auto lu = feed_limits(u, limits, acceleration);
+	auto lv = feed_limits(v, limits, acceleration);
+	axis_limits in_plane{std::min(lu.velocity, lv.velocity), std::min(lu.acceleration, lv.acceleration), std::min(lu.jerk, lv.jerk)};
+	
+	auto r = arc.radius().value();
+	auto planar = r * arc.angular_span().value() / length;
+	
+	auto path = path_limits(feed);
+	constrain(path, planar, in_plane);
+	constrain(path, std::abs(arc.helix().value()) / length, feed_limits(w, limits, acceleration));
+	
+	// Centripetal acceleration (v^2 / r) and jerk (v^3 / r^2) in the plane.
+	if(r > 0 && planar > 0)
+	{
+		path.velocity = std::min(path.velocity, std::sqrt(in_plane.acceleration * r) / planar);
+		path.velocity = std::min(path.velocity, std::cbrt(in_plane.jerk * r * r) / planar);
+	}
+	
+	double b[axis_count];
+	double e[axis_count];
+	axis_values(arc.start(), b);
+	axis_values(arc.end(), e);
+	for(auto axis : {Axis::Type::A, Axis::Type::B, Axis::Type::C})
+	{
+		auto i = static_cast<std::size_t>(axis);
+		constrain(path, std::abs(e[i] - b[i]) / length, feed_limits(axis, limits, acceleration));
+	}
+	return path;
+}
+
+}
+
+double profile_time(double distance, double velocity, double acceleration, double jerk)
+{
+	if(!(distance > 0))
+		return 0;
+	if(!(velocity > 0))
+		throw error("Movement with zero velocity will take infinite time.");
+	
+	if(std::isinf(velocity))
+		return 0;
+	if(std::isinf(acceleration))
+		return distance / velocity;
+	
+	if(std::isinf(jerk))
+	{
+		if(distance >= velocity * velocity / acceleration)
+			return distance / velocity + velocity / acceleration;
+		
+		// Triangular profile; cruise velocity is not reached.
+		return 2 * std::sqrt(distance / acceleration);
+	}
+	
+	/*
+	 * Time to accelerate from rest to v. Acceleration ramps up and down at
+	 * the jerk limit, holding at the acceleration limit if it is reached.
+	 * The profile is symmetric so the distance covered is v * t / 2.
+	 */
+	auto accel_time = [&](double v)
+	{
+		if(v * jerk >= acceleration * acceleration)
+			return v / acceleration + acceleration / jerk;
+		return 2 * std::sqrt(v / jerk);
+	};
+	
+	auto t = accel_time(velocity);
+	if(velocity * t <= distance)
+		return distance / velocity + t;
+	
+	// Peak velocity such that accelerating and decelerating covers the distance.
+	auto peak = std::cbrt(distance * distance * jerk / 4);
+	if(peak * jerk > acceleration * acceleration)
+	{
+		auto c = acceleration * acceleration / jerk;
+		peak = (-c + std::sqrt(c * c + 4 * distance * acceleration)) / 2;
+	}
+	return 2 * accel_time(peak);
+}
+
+units::time rapid_time(const Position& begin, const Position& end, const limits::Rapids& rapids, const limits::Acceleration& acceleration)
+{
+	double b[axis_count];
+	double e[axis_count];
+	axis_values(begin, b);
+	axis_values(end, e);
+	
+	double t = 0;
+	for(std::size_t i = 0; i < axis_count; ++i)
+	{
+		auto axis = axis_type(i);
+		auto distance = std::abs(e[i] - b[i]);
+		auto linear = is_linear(axis);
+		
+		auto velocity = linear ? rapids.LinearVelocity(axis).value() : rapids.AngularVelocity(axis).value();
+		if(velocity == 0)
+		{
+			if(distance != 0)
+			{
+				if(linear)
+					throw error("Linear movement on axis with zero velocity will take infinite time.");
+				throw error("Angular movement on axis with zero velocity will take infinite time.");
+			}
+			continue;
+		}
+		
+		if(linear)
+			t = std::max(t, profile_time(distance, velocity, acceleration.MaxLinear(axis).value(), acceleration.MaxLinearJerk(axis).value()));
+		else
+			t = std::max(t, profile_time(distance, velocity, acceleration.MaxAngular(axis).value(), acceleration.MaxAngularJerk(axis).value()));
+	}
+	return units::time::from_value(t);
+}
+
+units::time linear_time(const Position& begin, const Position& end, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration)
+{
+	double b[axis_count];
+	double e[axis_count];
+	axis_values(begin, b);
+	axis_values(end, e);
+	
+	double d[axis_count];
+	for(std::size_t i = 0; i < axis_count; ++i)
+		d[i] = std::abs(e[i] - b[i]);
+	auto length = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+	
+	if(length == 0)
+	{
+		double t = 0;
+		for(std::size_t i = 0; i < axis_count; ++i)
+		{
+			if(d[i] == 0)
+				continue;
+			
+			auto axis = feed_limits(axis_type(i), limits, acceleration);
+			if(std::isinf(axis.velocity))
+				throw error("Movement on axis without feed rate limit has no defined time.");
+			t = std::max(t, profile_time(d[i], axis.velocity, axis.acceleration, axis.jerk));
+		}
+		return units::time::from_value(t);
+	}
+	
+	auto path = linear_limits(d, length, feed, limits, acceleration);
+	return units::time::from_value(profile_time(length, path.velocity, path.acceleration, path.jerk));
+}
+
+units::time arc_time(const path::arc_plan& arc, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration)
+{
+	auto length = arc.length().value();
+	if(!(length > 0))
+		return {};
+	
+	auto path = arc_limits(arc, feed, limits, acceleration);
+	return units::time::from_value(profile_time(length, path.velocity, path.acceleration, path.jerk));
+}
+
+namespace
+{
+
+/*
+ * A move as seen by the planner; SI values.
+ * Directions are the unit cartesian tangents at the start and end.
+ */
+struct segment
+{
+	double length;
+	double velocity;
+	double acceleration;
+	double start[3];
+	double end[3];
+	
+	// Moves without cartesian motion; they stop at both ends and take a fixed time.
+	bool stop;
+	double time;
+};
+
+segment plan_segment(const path::move_t& move, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration)
+{
+	segment s{};
+	switch(move.type)
+	{
+		case path::move_t::Type::Linear:
+		case path::move_t::Type::Rotary:
+		{
+			double b[axis_count];
+			double e[axis_count];
+			axis_values(move.start, b);
+			axis_values(move.end, e);
+			
+			double d[axis_count];
+			for(std::size_t i = 0; i < axis_count; ++i)
+				d[i] = std::abs(e[i] - b[i]);
+			s.length = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+			if(s.length == 0)
+			{
+				s.stop = true;
+				s.time = linear_time(move.start, move.end, feed, limits, acceleration).value();
+				return s;
+			}
+			
+			auto path = linear_limits(d, s.length, feed, limits, acceleration);
+			s.velocity = path.velocity;
+			s.acceleration = path.acceleration;
+			for(int i = 0; i < 3; ++i)
+				s.start[i] = s.end[i] = (e[i] - b[i]) / s.length;
+			return s;
+		}
+		case path::move_t::Type::Arc:
+		{
+			path::arc_plan arc(move.start, move.end, move.center, move.dir, move.plane, move.turns);
+			s.length = arc.length().value();
+			if(!(s.length > 0))
+			{
+				s.stop = true;
+				return s;
+			}
+			
+			auto path = arc_limits(arc, feed, limits, acceleration);
+			s.velocity = path.velocity;
+			s.acceleration = path.acceleration;
+			
+			Axis::Type u;
+			Axis::Type v;
+			Axis::Type w;
+			arc_axes(arc, u, v, w);
+			
+			auto sweep = arc.sweep().value();
+			auto planar = arc.radius().value() * std::abs(sweep) / s.length;
+			auto sign = sweep < 0 ? -1.0 : 1.0;
+			auto helix = arc.helix().value() / s.length;
+			auto tangent = [&](double theta, double t[3])
+			{
+				t[static_cast<std::size_t>(u)] = -sign * planar * std::sin(theta);
+				t[static_cast<std::size_t>(v)] = sign * planar * std::cos(theta);
+				t[static_cast<std::size_t>(w)] = helix;
+			};
+			auto theta = arc.start_angle().value();
+			tangent(theta, s.start);
+			tangent(theta + sweep, s.end);
+			return s;
+		}
+	}
+	throw std::logic_error("Unknown move type.");
+}
+
+/*
+ * Greatest velocity through the junction from a into b.
+ * The corner is blended by an arc that deviates from it by at most
+ * `tolerance`; the velocity is that at which the centripetal acceleration on
+ * the blend equals the acceleration limit.
+ */
+double junction_velocity(const segment& a, const segment& b, double tolerance)
+{
+	if(a.stop || b.stop)
+		return 0;
+	
+	auto limit = std::min(a.velocity, b.velocity);
+	auto acceleration = std::min(a.acceleration, b.acceleration);
+	
+	// Cosine of the angle between the incoming and outgoing directions.
+	auto c = a.end[0] * b.start[0] + a.end[1] * b.start[1] + a.end[2] * b.start[2];
+	c = std::min(std::max(c, -1.0), 1.0);
+	if(c > 1 - 1e-12 || std::isinf(acceleration))
+		return limit;
+	
+	// sin(theta / 2) of the interior angle theta of the corner.
+	auto sin_half = std::sqrt(0.5 * (1 + c));
+	if(sin_half > 1 - 1e-12)
+		return limit;
+	return std::min(limit, std::sqrt(acceleration * tolerance * sin_half / (1 - sin_half)));
+}
+
+/*
+ * Time for a move entered at v0 and left at v1, accelerating at a up to
+ * the cruise velocity.
+ */
+double segment_time(const segment& s, double v0, double v1)
+{
+	if(s.stop)
+		return s.time;
+	if(std::isinf(s.acceleration))
+		return s.length / s.velocity;
+	
+	auto a = s.acceleration;
+	auto peak = std::sqrt((2 * a * s.length + v0 * v0 + v1 * v1) / 2);
+	if(peak <= s.velocity)
+		return (2 * peak - v0 - v1) / a;
+	
+	auto v = s.velocity;
+	auto accelerate = (v * v - v0 * v0) / (2 * a);
+	auto decelerate = (v * v - v1 * v1) / (2 * a);
+	return (2 * v - v0 - v1) / a + (s.length - accelerate - decelerate) / v;
+}
+
+/*
+ * Largest velocity from which a move can change to v within its length.
+ */
+double reachable(const segment& s, double v)
+{
+	if(s.stop)
+		return 0;
+	return std::sqrt(v * v + 2 * s.acceleration * s.length);
+}
+
+}
+
+plan_t plan(const std::vector<path::move_t>& moves, const std::vector<units::velocity>& feeds, const limits::FeedRate& limits, const limits::Acceleration& acceleration, units::length tolerance, std::size_t lookahead)
+{
+	if(feeds.size() != moves.size())
+		throw error("Feed rate required for each move.");
+	if(tolerance < units::length{})
+		throw error("Blending tolerance must not be negative.");
+	lookahead = std::max<std::size_t>(lookahead, 2);
+	
+	auto n = moves.size();
+	std::vector<segment> segments;
+	segments.reserve(n);
+	for(std::size_t i = 0; i < n; ++i)
+		segments.push_back(plan_segment(moves[i], feeds[i], limits, acceleration));
+	
+	// v[i] is the velocity entering move i; v[n] the velocity at the end of the program.
+	std::vector<double> v(n + 1, 0);
+	for(std::size_t i = 1; i < n; ++i)
+		v[i] = junction_velocity(segments[i-1], segments[i], tolerance.value());
+	
+	plan_t plan;
+	plan.entry.reserve(n);
+	plan.durations.reserve(n);
+	double total = 0;
+	
+	/*
+	 * Plan over a window assuming the machine must stop at its end, then
+	 * commit the first half. The velocity carried into the next window still
+	 * allows a stop by the end of this one, so it remains feasible whatever
+	 * lies beyond.
+	 */
+	auto commit = lookahead / 2;
+	std::vector<double> w;
+	for(std::size_t first = 0; first < n; )
+	{
+		auto last = std::min(n, first + lookahead);
+		auto done = last == n ? n : first + commit;
+		
+		w.assign(v.begin() + first, v.begin() + last + 1);
+		w.back() = 0;
+		for(auto i = last; i-- > first + 1; )
+			w[i - first] = std::min(w[i - first], reachable(segments[i], w[i - first + 1]));
+		for(auto i = first; i < last; ++i)
+			w[i - first + 1] = std::min(w[i - first + 1], reachable(segments[i], w[i - first]));
+		
+		for(auto i = first; i < done; ++i)
+		{
+			auto t = segment_time(segments[i], w[i - first], w[i - first + 1]);
+			plan.entry.push_back(units::velocity::from_value(w[i - first]));
+			plan.durations.push_back(units::time::from_value(t));
+			total += t;
+		}
+		v[done] = w[done - first];
+		first = done;
+	}
+	plan.duration = units::time::from_value(total);
+	return plan;
+}
+
+plan_t plan(const std::vector<path::move_t>& moves, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration, units::length tolerance, std::size_t lookahead)
+{
+	return plan(moves, std::vector<units::velocity>(moves.size(), feed), limits, acceleration, tolerance, lookahead);
+}
+
+units::time move_time(const path::move_t& move, units::velocity feed, const limits::FeedRate& limits, const limits::Acceleration& acceleration)
+{
+	switch(move.type)
+	{
+		case path::move_t::Type::Linear:
+		case path::move_t::Type::Rotary:
+			return linear_time(move.start, move.end, feed, limits, acceleration);
+		case path::move_t::Type::Arc:
+			return arc_time(path::arc_plan(move.start, move.end, move.center, move.dir, move.plane, move.turns), feed, limits, acceleration);
+	}
+	throw std::logic_error("Unknown move type.");
+}
+
+}
+}
+
@@ -0,0 +1,213 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Parallel.h
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace cxxcam
+{
+namespace parallel
+{
+
+/*
+ * Number of worker threads to use; 0 selects the hardware concurrency.
+ */
+inline unsigned thread_count(unsigned threads)
+{
+	if(threads == 0)
+		threads = std::thread::hardware_concurrency();
+	return std::max(threads, 1u);
+}
+
+/*
+ * Worker threads kept for the life of the process so repeated calls do not
+ * pay for thread creation. Threads are started as first needed.
+ * One task runs at a time; a caller that finds the pool busy (another
+ * thread's task, or a call from within a task on any thread) gets no
+ * helpers and runs the task alone.
+ */
+class thread_pool
+{
+private:
+	std::vector<std::thread> m_Threads;
+	std::mutex m_Mutex;
+	std::condition_variable m_Work;
+	std::condition_variable m_Done;
+	// Claimed by the caller whose task is running.
+	std::atomic<bool> m_Busy;
+	
+	const std::function<void()>* m_Task;
+	std::size_t m_Helpers;
+	std::size_t m_Pending;
+	unsigned long m_Generation;
+	bool m_Stop;
+	
+	void worker(std::size_t index)
+	{
+		unsigned long seen = 0;
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while(true)
+		{
+			m_Work.wait(lock, [&]{ return m_Stop || (m_Generation != seen && index < m_Helpers); });
+			if(m_Stop)
+				return;
+			seen = m_Generation;
+			auto task = m_Task;
+			lock.unlock();
+			(*task)();
+			lock.lock();
+			if(--m_Pending == 0)
+				m_Done.notify_one();
+		}
+	}
+public:
+	thread_pool()
+	 : m_Busy(false), m_Task(nullptr), m_Helpers(0), m_Pending(0), m_Generation(0), m_Stop(false)
+	{
+	}
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Work.notify_all();
+		for(auto& t : m_Threads)
+			t.join();
+	}
+	
+	static thread_pool& instance()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+	
+	/*
+	 * Runs task on the calling thread and up to `helpers` pool threads,
+	 * returning once all have finished. task must not throw.
+	 */
+	void run(std::size_t helpers, const std::function<void()>& task)
+	{
+		auto idle = false;
+		if(helpers > 0 && !m_Busy.compare_exchange_strong(idle, true))
+			helpers = 0;
+		auto owner = helpers > 0;
+		
+		if(helpers > 0)
+		{
+			try
+			{
+				while(m_Threads.size() < helpers)
+					m_Threads.emplace_back(&thread_pool::worker, this, m_Threads.size());
+			}
+			catch(const std::exception&)
+			{
+				// Continue with the threads that could be started.
+			}
+			helpers = std::min(helpers, m_Threads.size());
+		}
+		
+		if(helpers > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Task = &task;
+			m_Helpers = helpers;
+			m_Pending = helpers;
+			++m_Generation;
+		}
+		m_Work.notify_all();
+		
+		task();
+		
+		if(helpers > 0)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Done.wait(lock, [&]{ return m_Pending == 0; });
+			m_Helpers = 0;
+		}
+		if(owner)
+			m_Busy = false;
+	}
+	
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+};
+
+/*
+ * Calls f(first, last) for consecutive blocks of [0, n) on up to `threads` threads.
+ * Blocks are handed out dynamically so uneven work balances across threads;
+ * the threads other than the caller's come from thread_pool.
+ * If any call throws, the exception from the lowest block is rethrown once
+ * all threads have finished, so errors are reported deterministically.
+ */
+template <typename F>
+void for_blocks(std::size_t n, std::size_t block, unsigned threads, F f)
+{
+	if(n == 0)
+		return;
+
+	block = std::max<std::size_t>(block, 1);
+	auto blocks = (n + block - 1) / block;
+	threads = std::min<std::size_t>(thread_count(threads), blocks);
+	if(threads < 2)
+	{
+		f(std::size_t(0), n);
+		return;
+	}
+
+	std::atomic<std::size_t> next(0);
+	std::vector<std::exception_ptr> errors(blocks);
+	std::function<void()> worker = [&]()
+	{
+		std::size_t b;
+		while((b = next++) < blocks)
+		{
+			try
+			{
+				f(b * block, std::min(n, (b + 1) * block));
+			}
+			catch(...)
+			{
+				errors[b] = std::current_exception();
+			}
+		}
+	};
+
+	thread_pool::instance().run(threads - 1, worker);
+
+	for(auto& e : errors)
+		if(e)
+			std::rethrow_exception(e);
+}
+
+}
+}
+
+#endif /* PARALLEL_H_ */
@@ -0,0 +1,107 @@
+/* cxxcam - C++ CAD/CAM driver library.
+ * Copyright (C) 2013  Nicholas Gill
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ParseNumber.h
+ */
+
+#ifndef PARSENUMBER_H_
+#define PARSENUMBER_H_
+#include <cstdint>
+
+namespace cxxcam
+{
+
+// Exactly representable powers of ten.
+const double pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/*
+ * [+-]digits[.digits] or [+-].digits
+ * The first 19 significant digits are kept; the value is the integer
+ * mantissa scaled by an exact power of ten so it is correctly rounded
+ * while the mantissa fits in a double (15 digits). Independent of the
+ * locale.
+ */
+inline bool parse_number(const char*& p, const char* end, double& value)
+{
+	auto negative = false;
+	if(p != end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	
+	std::uint64_t mantissa = 0;
+	int digits = 0;
+	int scale = 0;
+	bool any = false;
+	for(; p != end && is_digit(*p); ++p)
+	{
+		any = true;
+		if(digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if(mantissa)
+				++digits;
+		}
+		else
+		{
+			++scale;
+		}
+	}
+	if(p != end && *p == '.')
+	{
+		for(++p; p != end && is_digit(*p); ++p)
+		{
+			any = true;
+			if(digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if(mantissa)
+					++digits;
+				--scale;
+			}
+		}
+	}
+	if(!any)
+		return false;
+	
+	value = static_cast<double>(mantissa);
+	if(mantissa)
+	{
+		for(; scale < -22; scale += 22)
+			value /= pow10[22];
+		for(; scale > 22; scale -= 22)
+			value *= pow10[22];
+		if(scale < 0)
+			value /= pow10[-scale];
+		else
+			value *= pow10[scale];
+	}
+	if(negative)
+		value = -value;
+	return true;
+}
+
+}
+
+#endif /* PARSENUMBER_H_ */
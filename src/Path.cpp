@@ -24,8 +24,15 @@
 
 #include "cxxcam/Path.h"
 #include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
 #include <boost/units/cmath.hpp>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "cxxcam/Math.h"
+#include "Parallel.h"
 
 namespace cxxcam
 {
@@ -60,67 +67,799 @@ std::ostream& operator<<(std::ostream& os, const step& step)
 	return os;
 }
 
+namespace
+{
+
+math::point_3 step_position(const Position& pos, const limits::AvailableAxes& geometry)
+{
+	// TODO how are uvw mapped into the cartesian space
+	math::point_3 p;
+	if(geometry.Has(Axis::Type::X))
+		p.x = pos.X;
+	if(geometry.Has(Axis::Type::Y))
+		p.y = pos.Y;
+	if(geometry.Has(Axis::Type::Z))
+		p.z = pos.Z;
+	return p;
+}
+
 /*
  * TODO
  * Rotations need to be validated.
  */
-step position2step(const Position& pos, const limits::AvailableAxes& geometry)
+math::quaternion_t step_orientation(const Position& pos, const limits::AvailableAxes& geometry)
 {
-	step s;
+	if(!limits::has_rotary(geometry))
+		return identity;
+	
+	auto q = identity;
 	for(auto axis : geometry)
 	{
 		switch(axis)
 		{
-			case Axis::Type::X:
-				s.position.x = pos.X;
-				break;
-			case Axis::Type::Y:
-				s.position.y = pos.Y;
-				break;
-			case Axis::Type::Z:
-				s.position.z = pos.Z;
-				break;
 			case Axis::Type::A:
 				if(pos.A != angular_zero)
-					s.orientation *= math::normalise(math::axis2quat(1, 0, 0, pos.A));
+					q *= math::normalise(math::axis2quat(1, 0, 0, pos.A));
 				break;
 			case Axis::Type::B:
 				if(pos.B != angular_zero)
-					s.orientation *= math::normalise(math::axis2quat(0, 1, 0, pos.B));
+					q *= math::normalise(math::axis2quat(0, 1, 0, pos.B));
 				break;
 			case Axis::Type::C:
 				if(pos.C != angular_zero)
-					s.orientation *= math::normalise(math::axis2quat(0, 0, 1, pos.C));
+					q *= math::normalise(math::axis2quat(0, 0, 1, pos.C));
 				break;
-			case Axis::Type::U:
-			case Axis::Type::V:
-			case Axis::Type::W:
-				// TODO how are uvw mapped into the cartesian space
+			default:
 				break;
 		}
 	}
-	s.orientation = math::normalise(s.orientation);
+	return math::normalise(q);
+}
+
+}
+
+step position2step(const Position& pos, const limits::AvailableAxes& geometry)
+{
+	step s;
+	s.position = step_position(pos, geometry);
+	s.orientation = step_orientation(pos, geometry);
 	return s;
-};
+}
 
 units::plane_angle pseudo_cartesian_distance(const Position& start, const Position& end)
 {
 	return units::plane_angle{sqrt((start.A-end.A)*(start.A-end.A) + (start.B-end.B)*(start.B-end.B) + (start.C-end.C)*(start.C-end.C))};
 }
 
-path_t expand_linear(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm)
+std::size_t path_soa::size() const
+{
+	return x.size();
+}
+bool path_soa::empty() const
 {
-	auto pos2step = [&geometry](const Position& pos) -> step
+	return x.empty();
+}
+void path_soa::clear()
+{
+	resize(0);
+}
+void path_soa::reserve(std::size_t n)
+{
+	for(auto v : {&x, &y, &z, &qw, &qx, &qy, &qz})
+		v->reserve(n);
+}
+void path_soa::resize(std::size_t n)
+{
+	for(auto v : {&x, &y, &z, &qw, &qx, &qy, &qz})
+		v->resize(n);
+}
+
+void path_soa::push_back(const step& s)
+{
+	x.push_back(s.position.x.value());
+	y.push_back(s.position.y.value());
+	z.push_back(s.position.z.value());
+	
+	qw.push_back(s.orientation.R_component_1());
+	qx.push_back(s.orientation.R_component_2());
+	qy.push_back(s.orientation.R_component_3());
+	qz.push_back(s.orientation.R_component_4());
+}
+void path_soa::set(std::size_t i, const step& s)
+{
+	x[i] = s.position.x.value();
+	y[i] = s.position.y.value();
+	z[i] = s.position.z.value();
+	
+	qw[i] = s.orientation.R_component_1();
+	qx[i] = s.orientation.R_component_2();
+	qy[i] = s.orientation.R_component_3();
+	qz[i] = s.orientation.R_component_4();
+}
+step path_soa::operator[](std::size_t i) const
+{
+	step s;
+	s.position.x = units::length::from_value(x[i]);
+	s.position.y = units::length::from_value(y[i]);
+	s.position.z = units::length::from_value(z[i]);
+	s.orientation = math::quaternion_t{qw[i], qx[i], qy[i], qz[i]};
+	return s;
+}
+
+struct step_range::generator
+{
+	// Positions the cursor at step s.
+	virtual void seek(cursor& c, std::size_t s) const
 	{
-		return position2step(pos, geometry);
-	};
+		c.index = s;
+	}
+	
+	// Moves the cursor to the following step.
+	virtual void advance(cursor& c) const
+	{
+		++c.index;
+	}
+	
+	virtual step operator()(const cursor& c) const = 0;
+	
+	// Writes steps [first, first + n) to out starting at index offset.
+	virtual void fill(std::size_t first, std::size_t n, path_soa& out, std::size_t offset) const
+	{
+		if(n == 0)
+			return;
+		
+		cursor c;
+		seek(c, first);
+		for(std::size_t i = 0; i < n; ++i)
+		{
+			if(i)
+				advance(c);
+			out.set(offset + i, (*this)(c));
+		}
+	}
+	
+	virtual ~generator() = default;
+};
+
+namespace
+{
+
+/*
+ * out[i] = origin + delta * ((first + i) / total_steps)
+ * The vector paths evaluate the same expression per lane so the
+ * result is identical to the scalar interpolation.
+ */
+void interpolate(double* out, std::size_t n, std::size_t first, double origin, double delta, double total_steps)
+{
+	std::size_t i = 0;
+#if defined(__AVX__)
+	const auto vorigin = _mm256_set1_pd(origin);
+	const auto vdelta = _mm256_set1_pd(delta);
+	const auto vtotal = _mm256_set1_pd(total_steps);
+	const auto vstride = _mm256_set1_pd(4.0);
+	auto s = static_cast<double>(first);
+	auto vs = _mm256_set_pd(s+3, s+2, s+1, s);
+	for(; i + 4 <= n; i += 4)
+	{
+		auto scale = _mm256_div_pd(vs, vtotal);
+		_mm256_storeu_pd(out + i, _mm256_add_pd(vorigin, _mm256_mul_pd(vdelta, scale)));
+		vs = _mm256_add_pd(vs, vstride);
+	}
+#elif defined(__SSE2__)
+	const auto vorigin = _mm_set1_pd(origin);
+	const auto vdelta = _mm_set1_pd(delta);
+	const auto vtotal = _mm_set1_pd(total_steps);
+	const auto vstride = _mm_set1_pd(2.0);
+	auto s = static_cast<double>(first);
+	auto vs = _mm_set_pd(s+1, s);
+	for(; i + 2 <= n; i += 2)
+	{
+		auto scale = _mm_div_pd(vs, vtotal);
+		_mm_storeu_pd(out + i, _mm_add_pd(vorigin, _mm_mul_pd(vdelta, scale)));
+		vs = _mm_add_pd(vs, vstride);
+	}
+#endif
+	for(; i < n; ++i)
+		out[i] = origin + delta * ((first + i) / total_steps);
+}
+
+/*
+ * Number of iterations of `for(size_t s = 0; s < total_steps; ++s)`
+ */
+std::size_t step_count(double total_steps)
+{
+	if(!(total_steps > 0))
+		return 0;
+	return static_cast<std::size_t>(std::ceil(total_steps));
+}
+
+step_range make_range(std::shared_ptr<const step_range::generator> gen, std::size_t steps, const step& sn, units::length length, units::plane_angle angular_length, const deviation_t& deviation)
+{
+	auto append_end = true;
+	if(steps)
+	{
+		step_range::cursor c;
+		gen->seek(c, steps-1);
+		append_end = (*gen)(c) != sn;
+	}
+	return { gen, steps, sn, append_end, length, angular_length, deviation };
+}
+
+struct fixed_generator : step_range::generator
+{
+	step s0;
+
+	explicit fixed_generator(const step& s0)
+	 : s0(s0)
+	{
+	}
+
+	step operator()(const step_range::cursor&) const override
+	{
+		return s0;
+	}
+};
+
+/*
+ * Angles are not evaluated with cos / sin per step.
+ * Every anchor_interval steps the (cos, sin) pair of an angle is evaluated
+ * directly and the steps in between are generated by rotating the previous
+ * pair by the precomputed per step rotation. Anchors are placed on fixed
+ * step indices so a step evaluates identically however it is reached, and
+ * the rounding accumulated between anchors bounds the deviation from direct
+ * evaluation to a few ulp per step (< 1e-13 relative).
+ */
+static const std::size_t anchor_interval = 64;
+
+struct angle_stepper
+{
+	units::plane_angle origin;
+	units::plane_angle delta;
+	double cos_delta;
+	double sin_delta;
+
+	angle_stepper()
+	 : origin(), delta(), cos_delta(1), sin_delta(0)
+	{
+	}
+	angle_stepper(units::plane_angle origin, units::plane_angle delta)
+	 : origin(origin), delta(delta), cos_delta(cos(delta)), sin_delta(sin(delta))
+	{
+	}
+
+	void anchor(step_range::rotation& r, std::size_t index) const
+	{
+		auto theta = origin + delta * static_cast<double>(index);
+		r.c = cos(theta);
+		r.s = sin(theta);
+	}
+	void rotate(step_range::rotation& r) const
+	{
+		auto c = r.c * cos_delta - r.s * sin_delta;
+		r.s = r.s * cos_delta + r.c * sin_delta;
+		r.c = c;
+	}
+};
+
+/*
+ * Orientation along a move with linearly interpolated rotary axes.
+ * Each axis contributes a rotation about a fixed axis whose half angle
+ * advances by a constant amount per step, so the per axis quaternions are
+ * stepped rather than rebuilt with axis2quat. They are composed in geometry
+ * order as in position2step; components agree with position2step to
+ * within 1e-12.
+ */
+struct orientation_stepper
+{
+	angle_stepper half_angle[3];
+	
+	// rotary axes (0 = A, 1 = B, 2 = C) in composition order.
+	// The geometry holds each axis at most once.
+	std::size_t rotary[3];
+	std::size_t count;
+
+	orientation_stepper()
+	 : count(0)
+	{
+	}
+
+	void add(std::size_t axis)
+	{
+		rotary[count++] = axis;
+	}
+
+	void init(const Position& start, const Position& axis_movement, double total_steps, const limits::AvailableAxes& geometry)
+	{
+		half_angle[0] = {start.A / 2.0, axis_movement.A / (2.0 * total_steps)};
+		half_angle[1] = {start.B / 2.0, axis_movement.B / (2.0 * total_steps)};
+		half_angle[2] = {start.C / 2.0, axis_movement.C / (2.0 * total_steps)};
+		
+		count = 0;
+		if(!limits::has_rotary(geometry))
+			return;
+		for(auto axis : geometry)
+		{
+			switch(axis)
+			{
+				case Axis::Type::A:
+					add(0);
+					break;
+				case Axis::Type::B:
+					add(1);
+					break;
+				case Axis::Type::C:
+					add(2);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	void anchor(step_range::cursor& c) const
+	{
+		for(std::size_t i = 0; i < count; ++i)
+			half_angle[rotary[i]].anchor(c.rotary[rotary[i]], c.index);
+	}
+	void rotate(step_range::cursor& c) const
+	{
+		for(std::size_t i = 0; i < count; ++i)
+			half_angle[rotary[i]].rotate(c.rotary[rotary[i]]);
+	}
+
+	math::quaternion_t operator()(const step_range::cursor& c) const
+	{
+		auto q = identity;
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			auto& r = c.rotary[rotary[i]];
+			switch(rotary[i])
+			{
+				case 0:
+					q *= math::quaternion_t{r.c, r.s, 0, 0};
+					break;
+				case 1:
+					q *= math::quaternion_t{r.c, 0, r.s, 0};
+					break;
+				case 2:
+					q *= math::quaternion_t{r.c, 0, 0, r.s};
+					break;
+			}
+		}
+		return math::normalise(q);
+	}
+};
+
+/*
+ * Generator for moves whose arc and rotary angles advance by a constant
+ * amount per step.
+ */
+struct stepped_generator : step_range::generator
+{
+	angle_stepper arc;
+	orientation_stepper orientation;
+
+	void anchor(step_range::cursor& c) const
+	{
+		arc.anchor(c.arc, c.index);
+		orientation.anchor(c);
+	}
+	void rotate(step_range::cursor& c) const
+	{
+		arc.rotate(c.arc);
+		orientation.rotate(c);
+	}
+
+	void seek(step_range::cursor& c, std::size_t s) const override
+	{
+		c.index = s - (s % anchor_interval);
+		anchor(c);
+		while(c.index != s)
+		{
+			++c.index;
+			rotate(c);
+		}
+	}
+	void advance(step_range::cursor& c) const override
+	{
+		if(++c.index % anchor_interval == 0)
+			anchor(c);
+		else
+			rotate(c);
+	}
+};
+
+/*
+ * Machine axis sets with specialised generators.
+ * position2step walks the geometry for every step; when the geometry is one
+ * of these sets the generator is instantiated for it once per move and the
+ * cartesian copy and orientation composition are resolved at compile time.
+ * Geometries with other axes or rotary orderings use the generic path.
+ */
+enum class axis_set
+{
+	generic,
+	xyz,
+	xyza,
+	xyzabc
+};
+
+template <axis_set Axes>
+using axes = std::integral_constant<axis_set, Axes>;
+
+axis_set classify(const limits::AvailableAxes& geometry)
+{
+	auto mask = geometry.Mask();
+	if(!limits::has_xyz(mask))
+		return axis_set::generic;
+	if(limits::is_pure_xyz(mask))
+		return axis_set::xyz;
+	
+	auto rotary = mask & limits::rotary_mask;
+	if(rotary == limits::axis_mask(Axis::Type::A))
+		return axis_set::xyza;
+	if(rotary != limits::rotary_mask)
+		return axis_set::generic;
+	
+	// Orientations are composed in geometry order.
+	Axis::Type order[3];
+	std::size_t count = 0;
+	for(auto axis : geometry)
+	{
+		if(!is_linear(axis))
+			order[count++] = axis;
+	}
+	if(order[0] == Axis::Type::A && order[1] == Axis::Type::B && order[2] == Axis::Type::C)
+		return axis_set::xyzabc;
+	return axis_set::generic;
+}
+
+template <axis_set Axes>
+math::point_3 position_at(const Position& p, const limits::AvailableAxes&, axes<Axes>)
+{
+	return {p.X, p.Y, p.Z};
+}
+math::point_3 position_at(const Position& p, const limits::AvailableAxes& geometry, axes<axis_set::generic>)
+{
+	return step_position(p, geometry);
+}
+
+math::quaternion_t orientation_at(const orientation_stepper& o, const step_range::cursor& c, axes<axis_set::generic>)
+{
+	return o(c);
+}
+math::quaternion_t orientation_at(const orientation_stepper&, const step_range::cursor&, axes<axis_set::xyz>)
+{
+	return identity;
+}
+math::quaternion_t orientation_at(const orientation_stepper&, const step_range::cursor& c, axes<axis_set::xyza>)
+{
+	auto& a = c.rotary[0];
+	return math::normalise(math::quaternion_t{a.c, a.s, 0, 0});
+}
+math::quaternion_t orientation_at(const orientation_stepper&, const step_range::cursor& c, axes<axis_set::xyzabc>)
+{
+	auto& a = c.rotary[0];
+	auto& b = c.rotary[1];
+	auto& cc = c.rotary[2];
+	return math::normalise(math::quaternion_t{a.c, a.s, 0, 0} * math::quaternion_t{b.c, 0, b.s, 0} * math::quaternion_t{cc.c, 0, 0, cc.s});
+}
+
+/*
+ * Allocates a generator from the arena when one is given. The control block
+ * and generator share one allocation; the arena must outlive the range.
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> make_generator(arena* storage, Args&&... args)
+{
+	if(storage)
+		return std::allocate_shared<T>(arena_allocator<T>(*storage), std::forward<Args>(args)...);
+	return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+/*
+ * Instantiates Generator for the axis set of the geometry.
+ */
+template <template <axis_set> class Generator>
+auto specialise(const limits::AvailableAxes& geometry, arena* storage) -> std::shared_ptr<typename Generator<axis_set::generic>::base_type>
+{
+	switch(classify(geometry))
+	{
+		case axis_set::xyz:
+			return make_generator<Generator<axis_set::xyz>>(storage);
+		case axis_set::xyza:
+			return make_generator<Generator<axis_set::xyza>>(storage);
+		case axis_set::xyzabc:
+			return make_generator<Generator<axis_set::xyzabc>>(storage);
+		case axis_set::generic:
+			break;
+	}
+	return make_generator<Generator<axis_set::generic>>(storage);
+}
+
+struct linear_generator : stepped_generator
+{
+	Position start;
+	Position axis_movement;
+	double total_steps;
+	limits::AvailableAxes geometry;
+};
+
+template <axis_set Axes>
+struct linear_generator_t : linear_generator
+{
+	typedef linear_generator base_type;
 	
-	auto s0 = pos2step(start);
-	auto sn = pos2step(end);
+	step operator()(const step_range::cursor& c) const override
+	{
+		auto scale = c.index / total_steps;
+		
+		// starting at `start` move a scaled amount towards `end`
+		Position p = start;
+		
+		p.X += axis_movement.X * scale;
+		p.Y += axis_movement.Y * scale;
+		p.Z += axis_movement.Z * scale;
+		
+		step s;
+		s.position = position_at(p, geometry, axes<Axes>());
+		s.orientation = orientation_at(orientation, c, axes<Axes>());
+		return s;
+	}
+	
+	void fill(std::size_t first, std::size_t n, path_soa& out, std::size_t offset) const override
+	{
+		if(n == 0)
+			return;
+		
+		auto axis = [&](Axis::Type type, units::length origin, units::length delta, std::vector<double>& v)
+		{
+			if(Axes != axis_set::generic || geometry.Has(type))
+				interpolate(v.data() + offset, n, first, origin.value(), delta.value(), total_steps);
+			else
+				std::fill_n(v.begin() + offset, n, 0.0);
+		};
+		axis(Axis::Type::X, start.X, axis_movement.X, out.x);
+		axis(Axis::Type::Y, start.Y, axis_movement.Y, out.y);
+		axis(Axis::Type::Z, start.Z, axis_movement.Z, out.z);
+		
+		if(Axes == axis_set::xyz)
+		{
+			std::fill_n(out.qw.begin() + offset, n, 1.0);
+			std::fill_n(out.qx.begin() + offset, n, 0.0);
+			std::fill_n(out.qy.begin() + offset, n, 0.0);
+			std::fill_n(out.qz.begin() + offset, n, 0.0);
+			return;
+		}
+		
+		step_range::cursor c;
+		seek(c, first);
+		for(std::size_t i = 0; i < n; ++i)
+		{
+			if(i)
+				advance(c);
+			auto q = orientation_at(orientation, c, axes<Axes>());
+			out.qw[offset + i] = q.R_component_1();
+			out.qx[offset + i] = q.R_component_2();
+			out.qy[offset + i] = q.R_component_3();
+			out.qz[offset + i] = q.R_component_4();
+		}
+	}
+};
+
+struct rotary_generator : stepped_generator
+{
+	math::point_3 position;
+};
+
+template <axis_set Axes>
+struct rotary_generator_t : rotary_generator
+{
+	typedef rotary_generator base_type;
+	
+	step operator()(const step_range::cursor& c) const override
+	{
+		step s;
+		s.position = position;
+		s.orientation = orientation_at(orientation, c, axes<Axes>());
+		return s;
+	}
+};
+
+struct arc_generator : stepped_generator
+{
+	Position start;
+	math::vector_3 plane;
+	math::point_3 arc_center;
+	units::length r;
+	units::length hdt;
+	limits::AvailableAxes geometry;
+};
+
+template <axis_set Axes>
+struct arc_generator_t : arc_generator
+{
+	typedef arc_generator base_type;
+	
+	step operator()(const step_range::cursor& c) const override
+	{
+		Position p = start;
+		auto sd = static_cast<double>(c.index);
+		auto& t = c.arc;
+		
+		if(plane.z)
+		{
+			p.X = (t.c*r)+arc_center.x;
+			p.Y = (t.s*r)+arc_center.y;
+			p.Z += (hdt*sd);
+		}
+		else if(plane.y)
+		{
+			p.X = (t.c*r)+arc_center.x;
+			p.Y += (hdt*sd);
+			p.Z = (t.s*r)+arc_center.y;
+		}
+		else if(plane.x)
+		{
+			p.X += (hdt*sd);
+			p.Y = (t.s*r)+arc_center.y;
+			p.Z = (t.c*r)+arc_center.x;
+		}
+		
+		step s;
+		s.position = position_at(p, geometry, axes<Axes>());
+		s.orientation = orientation_at(orientation, c, axes<Axes>());
+		return s;
+	}
+};
+
+}
+
+step_range::const_iterator::const_iterator()
+ : m_Range(nullptr), m_Index(0), m_Cursor(), m_Step()
+{
+}
+step_range::const_iterator::const_iterator(const step_range* range, std::size_t index)
+ : m_Range(range), m_Index(index), m_Cursor(), m_Step()
+{
+	if(m_Index < m_Range->m_Steps)
+		m_Range->m_Generator->seek(m_Cursor, m_Index);
+	evaluate();
+}
+
+void step_range::const_iterator::evaluate()
+{
+	if(m_Index < m_Range->m_Steps)
+		m_Step = (*m_Range->m_Generator)(m_Cursor);
+	else if(m_Index < m_Range->size())
+		m_Step = m_Range->m_End;
+}
+
+auto step_range::const_iterator::operator*() const -> reference
+{
+	return m_Step;
+}
+auto step_range::const_iterator::operator->() const -> pointer
+{
+	return &m_Step;
+}
+
+auto step_range::const_iterator::operator++() -> const_iterator&
+{
+	if(++m_Index < m_Range->m_Steps)
+		m_Range->m_Generator->advance(m_Cursor);
+	evaluate();
+	return *this;
+}
+auto step_range::const_iterator::operator++(int) -> const_iterator
+{
+	auto it = *this;
+	++*this;
+	return it;
+}
+
+bool step_range::const_iterator::operator==(const const_iterator& o) const
+{
+	return m_Range == o.m_Range && m_Index == o.m_Index;
+}
+bool step_range::const_iterator::operator!=(const const_iterator& o) const
+{
+	return !(*this == o);
+}
+
+step_range::step_range()
+ : m_Generator(), m_Steps(0), m_End(), m_AppendEnd(false), m_Length(), m_AngularLength(), m_Deviation()
+{
+}
+step_range::step_range(std::shared_ptr<const generator> gen, std::size_t steps, const step& end, bool append_end, units::length length, units::plane_angle angular_length, const deviation_t& deviation)
+ : m_Generator(gen), m_Steps(steps), m_End(end), m_AppendEnd(append_end), m_Length(length), m_AngularLength(angular_length), m_Deviation(deviation)
+{
+}
+
+auto step_range::begin() const -> const_iterator
+{
+	return {this, 0};
+}
+auto step_range::end() const -> const_iterator
+{
+	return {this, size()};
+}
+std::size_t step_range::size() const
+{
+	return m_Steps + (m_AppendEnd ? 1 : 0);
+}
+bool step_range::empty() const
+{
+	return size() == 0;
+}
+
+void step_range::append(path_soa& out) const
+{
+	auto offset = out.size();
+	out.resize(offset + size());
+	m_Generator->fill(0, m_Steps, out, offset);
+	if(m_AppendEnd)
+		out.set(offset + m_Steps, m_End);
+}
+
+units::length step_range::length() const
+{
+	return m_Length;
+}
+units::plane_angle step_range::angular_length() const
+{
+	return m_AngularLength;
+}
+deviation_t step_range::deviation() const
+{
+	return m_Deviation;
+}
+
+namespace
+{
+
+void check_tolerance(const deviation_t& tolerance)
+{
+	if(!(tolerance.chordal > units::length{}) || !(tolerance.angular > angular_zero))
+		throw std::runtime_error("Sampling tolerance must be positive.");
+}
+
+/*
+ * Number of steps required so that no step covers more than max
+ */
+double tolerance_steps(double total, double max)
+{
+	return std::max(1.0, std::ceil(total / max));
+}
+
+/*
+ * Rotary travel between consecutive steps in the pseudo cartesian ABC space.
+ */
+units::plane_angle angular_deviation(units::plane_angle angular_length, std::size_t steps)
+{
+	return angular_length / static_cast<double>(std::max<std::size_t>(steps, 1));
+}
+
+/*
+ * Sagitta of the chord spanning dtheta on an arc of radius r.
+ */
+units::length chordal_deviation(units::length r, units::plane_angle dtheta)
+{
+	return r * (1.0 - cos(abs(dtheta) / 2.0));
+}
+
+step_range linear_range(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm, const deviation_t* tolerance, arena* storage)
+{
+	auto s0 = position2step(start, geometry);
+	auto sn = position2step(end, geometry);
 	auto length = units::length_mm(distance(s0.position, sn.position)).value();
 	auto pseudo_cartesian_length = units::plane_angle_deg{pseudo_cartesian_distance(start, end)}.value();
 
-	Position axis_movement;
+	auto gen = specialise<linear_generator_t>(geometry, storage);
+	gen->start = start;
+	gen->geometry = geometry;
+	
+	auto& axis_movement = gen->axis_movement;
 	axis_movement.X = end.X - start.X;
 	axis_movement.Y = end.Y - start.Y;
 	axis_movement.Z = end.Z - start.Z;
@@ -133,24 +872,30 @@ path_t expand_linear(const Position& start, const Position& end, const limits::A
 	axis_movement.V = end.V - start.V;
 	axis_movement.W = end.W - start.W;
 
-	path_t path;
-	path.length = units::length{length * units::millimeters};
-	path.angular_length = units::plane_angle{pseudo_cartesian_length * units::degrees};
-
-    auto is_pure_linear = [pseudo_cartesian_length]() -> bool
-    {
-        return pseudo_cartesian_length < 1e6;
-    };
-
-    if(is_pure_linear() && steps_per_mm < 0)
-    {
-        path.path.push_back(s0);
-        path.path.push_back(sn);
-    }
-    else
-    {
+	auto path_length = units::length{length * units::millimeters};
+	auto angular_length = units::plane_angle{pseudo_cartesian_length * units::degrees};
+	
+	double total_steps;
+	if(tolerance)
+	{
+		// Linear motion is exact between any two steps; only rotary motion requires sampling.
+		total_steps = tolerance_steps(angular_length.value(), tolerance->angular.value());
+	}
+	else
+	{
+        auto is_pure_linear = [pseudo_cartesian_length]() -> bool
+        {
+            return pseudo_cartesian_length < 1e6;
+        };
+
+        if(is_pure_linear() && steps_per_mm < 0)
+        {
+            // start and end steps only.
+            return { make_generator<fixed_generator>(storage, s0), 1, sn, true, path_length, angular_length, {{}, angular_length} };
+        }
+
         steps_per_mm = std::abs(steps_per_mm);
-        auto total_steps = length * steps_per_mm;
+        total_steps = length * steps_per_mm;
 
         /*
         If the length of the movement is less than the degrees travelled in the pseudo cartesian ABC coordinate system
@@ -159,131 +904,93 @@ path_t expand_linear(const Position& start, const Position& end, const limits::A
         */
         if(length < pseudo_cartesian_length)
             total_steps = pseudo_cartesian_length * steps_per_mm;
+	}
 
-        for(size_t s = 0; s < total_steps; ++s)
-        {
-            auto scale = s / static_cast<double>(total_steps);
-            
-            // starting at `start` move a scaled amount towards `end`
-            Position p = start;
-            
-            p.X += axis_movement.X * scale;
-            p.Y += axis_movement.Y * scale;
-            p.Z += axis_movement.Z * scale;
-
-            p.A += axis_movement.A * scale;
-            p.B += axis_movement.B * scale;
-            p.C += axis_movement.C * scale;
-
-            p.U += axis_movement.U * scale;
-            p.V += axis_movement.V * scale;
-            p.W += axis_movement.W * scale;
-            
-            path.path.push_back(pos2step(p));
-        }
-        
-        if(path.path.empty() || path.path.back() != sn)
-            path.path.push_back(sn);
-    }
-	
-	return path;
+	gen->total_steps = total_steps;
+	gen->orientation.init(start, axis_movement, total_steps, geometry);
+	auto steps = step_count(total_steps);
+	return make_range(gen, steps, sn, path_length, angular_length, {{}, angular_deviation(angular_length, steps)});
 }
 
-path_t expand_rotary(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree)
+step_range rotary_range(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree, const deviation_t* tolerance, arena* storage)
 {
-	auto pos2step = [&geometry](const Position& pos) -> step
-	{
-		return position2step(pos, geometry);
-	};
-	
 	auto pseudo_cartesian_length = units::plane_angle_deg{pseudo_cartesian_distance(start, end)}.value();
 	
-	Position axis_movement;
-	axis_movement.A = end.A - start.A;
-	axis_movement.B = end.B - start.B;
-	axis_movement.C = end.C - start.C;
-	
-	path_t path;
-	path.angular_length = units::plane_angle{pseudo_cartesian_length * units::degrees};
-	auto total_steps = pseudo_cartesian_length * steps_per_degree;
+	auto gen = specialise<rotary_generator_t>(geometry, storage);
+	gen->position = step_position(start, geometry);
 	
-	for(size_t s = 0; s < total_steps; ++s)
-	{
-		auto scale = s / static_cast<double>(total_steps);
-		
-		// starting at `start` move a scaled amount towards `end`
-		Position p = start;
-		
-		p.A += axis_movement.A * scale;
-		p.B += axis_movement.B * scale;
-		p.C += axis_movement.C * scale;
-		
-		path.path.push_back(pos2step(p));
-	}
+	Position axis_movement;
+	axis_movement.A = end.A - start.A;
+	axis_movement.B = end.B - start.B;
+	axis_movement.C = end.C - start.C;
 	
-	auto sn = pos2step(end);
-	if(path.path.empty() || path.path.back() != sn)
-		path.path.push_back(sn);
+	auto angular_length = units::plane_angle{pseudo_cartesian_length * units::degrees};
+	double total_steps;
+	if(tolerance)
+		total_steps = tolerance_steps(angular_length.value(), tolerance->angular.value());
+	else
+		total_steps = pseudo_cartesian_length * steps_per_degree;
+	gen->orientation.init(start, axis_movement, total_steps, geometry);
 	
-	return path;
+	auto steps = step_count(total_steps);
+	return make_range(gen, steps, position2step(end, geometry), {}, angular_length, {{}, angular_deviation(angular_length, steps)});
 }
 
-path_t expand_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm)
+}
+
+namespace
 {
-	auto pos2step = [&geometry](const Position& pos) -> step
-	{
-		return position2step(pos, geometry);
-	};
-	
-	auto pseudo_cartesian_length = units::plane_angle_deg{pseudo_cartesian_distance(start, end)}.value();
-	
-	static const double PI = 3.14159265358979323846;
-	static const units::plane_angle PI2_r( 2 * PI * units::radians );
 
-	auto helix_length = [](double r, double h, double p) -> double
-	{
-		double c = h / (2*PI);
-		auto l = (2*PI*p) * sqrt((r*r) + (c*c));
-		return l;
-	};
-	
+const double PI = 3.14159265358979323846;
+const units::plane_angle PI2_r( 2 * PI * units::radians );
+
+double helix_length(double r, double h, double p)
+{
+	double c = h / (2*PI);
+	auto l = (2*PI*p) * sqrt((r*r) + (c*c));
+	return l;
+}
+
+}
+
+arc_plan::arc_plan(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns)
+ : m_Start(start), m_End(end), m_Plane(plane)
+{
 	math::point_3 arc_start;
 	math::point_3 arc_end;
-	units::length helix;
-	math::point_3 arc_center;
 	
 	if(plane.z == 1)
 	{
 		arc_start = math::point_3{start.X, start.Y, 0};
 		arc_end = math::point_3{end.X, end.Y, 0};
-		helix = units::length(end.Z - start.Z);
-		arc_center = math::point_3{center.X, center.Y, 0};
+		m_Helix = units::length(end.Z - start.Z);
+		m_Center = math::point_3{center.X, center.Y, 0};
 	}
 	else if(plane.y == 1)
 	{
 		arc_start = math::point_3{start.X, start.Z, 0};
 		arc_end = math::point_3{end.X, end.Z, 0};
-		helix = units::length(end.Y - start.Y);
-		arc_center = math::point_3{center.X, center.Z, 0};
+		m_Helix = units::length(end.Y - start.Y);
+		m_Center = math::point_3{center.X, center.Z, 0};
 	}
 	else if(plane.x == 1)
 	{
 		arc_start = math::point_3{start.Z, start.Y, 0};
 		arc_end = math::point_3{end.Z, end.Y, 0};
-		helix = units::length(end.X - start.X);
-		arc_center = math::point_3{center.Z, center.Z, 0};
+		m_Helix = units::length(end.X - start.X);
+		m_Center = math::point_3{center.Z, center.Y, 0};
 	}
 	else
 		throw std::runtime_error("Unsupported Arc Plane");
 	
-	if(!equidistant(arc_start, arc_end, arc_center, units::length{1e-6 * units::millimeters}))
+	if(!equidistant(arc_start, arc_end, m_Center, units::length{1e-6 * units::millimeters}))
 		throw std::runtime_error("Arc center not equidistant from start and end points.");
 
-	auto r = distance(arc_start, arc_center);
-	auto start_theta = atan2(arc_start.y - arc_center.y, arc_start.x - arc_center.x);
-	auto end_theta = atan2(arc_end.y - arc_center.y, arc_end.x - arc_center.x);
+	m_Radius = distance(arc_start, m_Center);
+	m_StartTheta = atan2(arc_start.y - m_Center.y, arc_start.x - m_Center.x);
+	auto end_theta = atan2(arc_end.y - m_Center.y, arc_end.x - m_Center.x);
 	auto turn_theta = PI2_r * (turns-1);
-	auto delta_theta = end_theta - start_theta;
+	auto delta_theta = end_theta - m_StartTheta;
 	switch(dir)
 	{
 		case ArcDirection::Clockwise:
@@ -305,157 +1012,439 @@ path_t expand_arc(const Position& start, const Position& end, const Position_Car
 	}
 	
 	turn_theta += fabs(delta_theta);
+	m_Sweep = delta_theta < units::plane_angle(0) ? -turn_theta : turn_theta;
 	
-	auto length = helix_length(units::length_mm(r).value(), units::length_mm{helix / units::plane_angle_rads{turn_theta}.value()}.value(), units::plane_angle_rads(turn_theta / (2*PI)).value());
-	size_t total_steps = length * steps_per_mm;
-	
-	/*
-	As for linear movement, if the length of the movement is less than the degrees travelled in the pseudo cartesian ABC coordinate system
-	then trade oversampling for undersampling by treating the degrees travelled as length units and reinterpret
-	steps_per_mm as steps_per_degree and use that to sample the path.
-	*/
-	if(length < pseudo_cartesian_length)
-		total_steps = pseudo_cartesian_length * steps_per_mm;
-	
-	auto rads_per_step = turn_theta / static_cast<double>(total_steps);
-	
-	auto step_dt = delta_theta < units::plane_angle(0) ? -rads_per_step : rads_per_step;
-	
-	Position axis_movement;
-	axis_movement.A = end.A - start.A;
-	axis_movement.B = end.B - start.B;
-	axis_movement.C = end.C - start.C;
+	m_Length = units::length(helix_length(units::length_mm(m_Radius).value(), units::length_mm{m_Helix / units::plane_angle_rads{turn_theta}.value()}.value(), units::plane_angle_rads(turn_theta / (2*PI)).value()) * units::millimeters);
+}
 
-	axis_movement.U = end.U - start.U;
-	axis_movement.V = end.V - start.V;
-	axis_movement.W = end.W - start.W;
+const Position& arc_plan::start() const
+{
+	return m_Start;
+}
+const Position& arc_plan::end() const
+{
+	return m_End;
+}
+units::length arc_plan::length() const
+{
+	return m_Length;
+}
+units::length arc_plan::radius() const
+{
+	return m_Radius;
+}
+units::length arc_plan::helix() const
+{
+	return m_Helix;
+}
+const math::vector_3& arc_plan::plane() const
+{
+	return m_Plane;
+}
+units::plane_angle arc_plan::start_angle() const
+{
+	return m_StartTheta;
+}
+units::plane_angle arc_plan::angular_span() const
+{
+	return abs(m_Sweep);
+}
+units::plane_angle arc_plan::sweep() const
+{
+	return m_Sweep;
+}
+
+/*
+ * The extent in the arc plane is bounded by the start and end points and
+ * any quadrant point (where the circle crosses an axis through the center)
+ * within the sweep. The helix axis is monotonic so its extent is that of the
+ * start and end points.
+ */
+Bbox arc_plan::bounding_box() const
+{
+	math::point_3 start{m_Start.X, m_Start.Y, m_Start.Z};
+	math::point_3 end{m_End.X, m_End.Y, m_End.Z};
+	Bbox box{start, start};
+	box += end;
 	
-	path_t path;
-	path.length = units::length{length * units::millimeters};
-	path.angular_length = units::plane_angle{pseudo_cartesian_length * units::degrees};
-	auto t = start_theta;
-	auto hdt = helix / static_cast<double>(total_steps);
-	for(size_t s = 0; s < total_steps; ++s, t += step_dt)
+	auto quadrant = [&](int k)
 	{
-		Position p = start;
-		auto sd = static_cast<double>(s);
+		static const double unit[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+		auto q = ((k % 4) + 4) % 4;
+		auto u = m_Center.x + m_Radius * unit[q][0];
+		auto v = m_Center.y + m_Radius * unit[q][1];
 		
-		if(plane.z)
+		auto p = start;
+		if(m_Plane.z == 1)
 		{
-			p.X = (cos(t)*r)+arc_center.x;
-			p.Y = (sin(t)*r)+arc_center.y;
-			p.Z += (hdt*sd);
+			p.x = u;
+			p.y = v;
 		}
-		else if(plane.y)
+		else if(m_Plane.y == 1)
 		{
-			p.X = (cos(t)*r)+arc_center.x;
-			p.Y += (hdt*sd);
-			p.Z = (sin(t)*r)+arc_center.z;
+			p.x = u;
+			p.z = v;
 		}
-		else if(plane.x)
+		else
 		{
-			p.X += (hdt*sd);
-			p.Y = (sin(t)*r)+arc_center.y;
-			p.Z = (cos(t)*r)+arc_center.z;
+			p.z = u;
+			p.y = v;
 		}
-		
-		auto scale = s / static_cast<double>(total_steps);
-		
-		p.A += axis_movement.A * scale;
-		p.B += axis_movement.B * scale;
-		p.C += axis_movement.C * scale;
+		box += p;
+	};
+	
+	auto theta0 = m_StartTheta.value();
+	auto theta1 = theta0 + m_Sweep.value();
+	auto lo = std::min(theta0, theta1);
+	auto hi = std::max(theta0, theta1);
+	if(hi - lo >= 2*PI)
+	{
+		for(int k = 0; k < 4; ++k)
+			quadrant(k);
+	}
+	else
+	{
+		auto first = static_cast<int>(std::ceil(lo / (PI/2)));
+		auto last = static_cast<int>(std::floor(hi / (PI/2)));
+		for(int k = first; k <= last; ++k)
+			quadrant(k);
+	}
+	return box;
+}
 
-		p.U += axis_movement.U * scale;
-		p.V += axis_movement.V * scale;
-		p.W += axis_movement.W * scale;
+step_range arc_plan::range(const limits::AvailableAxes& geometry, size_t steps_per_mm, const deviation_t* tolerance, arena* storage) const
+{
+	auto& start = m_Start;
+	auto& end = m_End;
+	auto& r = m_Radius;
+	auto turn_theta = abs(m_Sweep);
+	auto length = units::length_mm(m_Length).value();
+	auto pseudo_cartesian_length = units::plane_angle_deg{pseudo_cartesian_distance(start, end)}.value();
+	
+	size_t total_steps;
+	auto angular_length = units::plane_angle{pseudo_cartesian_length * units::degrees};
+	
+	if(tolerance)
+	{
+		/*
+		The chord between two steps deviates from the helix radially by the sagitta
+		of the in-plane arc; the linear helix component lies on the chord.
+		Solve r(1 - cos(dtheta/2)) <= chordal for dtheta.
+		*/
+		auto ratio = std::min(1.0, (tolerance->chordal / r).value());
+		auto max_dtheta = 2.0 * std::acos(1.0 - ratio);
+		total_steps = std::max(tolerance_steps(turn_theta.value(), max_dtheta), tolerance_steps(angular_length.value(), tolerance->angular.value()));
+	}
+	else
+	{
+		total_steps = length * steps_per_mm;
 		
-		path.path.push_back(pos2step(p));
+		/*
+		As for linear movement, if the length of the movement is less than the degrees travelled in the pseudo cartesian ABC coordinate system
+		then trade oversampling for undersampling by treating the degrees travelled as length units and reinterpret
+		steps_per_mm as steps_per_degree and use that to sample the path.
+		*/
+		if(length < pseudo_cartesian_length)
+			total_steps = pseudo_cartesian_length * steps_per_mm;
 	}
 	
-	auto sn = pos2step(end);
-	if(path.path.empty() || path.path.back() != sn)
-		path.path.push_back(sn);
+	auto rads_per_step = turn_theta / static_cast<double>(total_steps);
+	
+	auto step_dt = m_Sweep < units::plane_angle(0) ? -rads_per_step : rads_per_step;
 	
+	Position axis_movement;
+	axis_movement.A = end.A - start.A;
+	axis_movement.B = end.B - start.B;
+	axis_movement.C = end.C - start.C;
+	
+	auto gen = specialise<arc_generator_t>(geometry, storage);
+	gen->start = start;
+	gen->plane = m_Plane;
+	gen->arc_center = m_Center;
+	gen->r = r;
+	gen->arc = {m_StartTheta, step_dt};
+	gen->orientation.init(start, axis_movement, total_steps, geometry);
+	gen->hdt = m_Helix / static_cast<double>(total_steps);
+	gen->geometry = geometry;
+	
+	deviation_t deviation{ chordal_deviation(r, turn_theta / static_cast<double>(std::max<std::size_t>(total_steps, 1))), angular_deviation(angular_length, total_steps) };
+	return make_range(gen, total_steps, position2step(end, geometry), m_Length, angular_length, deviation);
+}
+
+step_range arc_plan::steps(const limits::AvailableAxes& geometry, size_t steps_per_mm) const
+{
+	return range(geometry, steps_per_mm, nullptr, nullptr);
+}
+step_range arc_plan::steps(const limits::AvailableAxes& geometry, const deviation_t& tolerance) const
+{
+	check_tolerance(tolerance);
+	return range(geometry, 0, &tolerance, nullptr);
+}
+step_range arc_plan::steps(const limits::AvailableAxes& geometry, size_t steps_per_mm, arena& storage) const
+{
+	return range(geometry, steps_per_mm, nullptr, &storage);
+}
+step_range arc_plan::steps(const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage) const
+{
+	check_tolerance(tolerance);
+	return range(geometry, 0, &tolerance, &storage);
+}
+
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm)
+{
+	return linear_range(start, end, geometry, steps_per_mm, nullptr, nullptr);
+}
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm, arena& storage)
+{
+	return linear_range(start, end, geometry, steps_per_mm, nullptr, &storage);
+}
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	check_tolerance(tolerance);
+	return linear_range(start, end, geometry, 0, &tolerance, nullptr);
+}
+step_range linear_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage)
+{
+	check_tolerance(tolerance);
+	return linear_range(start, end, geometry, 0, &tolerance, &storage);
+}
+
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree)
+{
+	return rotary_range(start, end, geometry, steps_per_degree, nullptr, nullptr);
+}
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree, arena& storage)
+{
+	return rotary_range(start, end, geometry, steps_per_degree, nullptr, &storage);
+}
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	check_tolerance(tolerance);
+	return rotary_range(start, end, geometry, 0, &tolerance, nullptr);
+}
+step_range rotary_steps(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage)
+{
+	check_tolerance(tolerance);
+	return rotary_range(start, end, geometry, 0, &tolerance, &storage);
+}
+
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm)
+{
+	return arc_plan(start, end, center, dir, plane, turns).steps(geometry, steps_per_mm);
+}
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm, arena& storage)
+{
+	return arc_plan(start, end, center, dir, plane, turns).steps(geometry, steps_per_mm, storage);
+}
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	return arc_plan(start, end, center, dir, plane, turns).steps(geometry, tolerance);
+}
+step_range arc_steps(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage)
+{
+	return arc_plan(start, end, center, dir, plane, turns).steps(geometry, tolerance, storage);
+}
+
+path_t expand(const step_range& steps)
+{
+	path_t path;
+	expand_into(path, steps);
 	return path;
 }
 
-units::length length_linear(const Position& start, const Position& end)
+void expand_into(path_t& path, const step_range& steps)
 {
-    return math::distance({start.X, start.Y, start.Z}, {end.X, end.Y, end.Z});
+	expand_into(path.path, steps);
+	path.length = steps.length();
+	path.angular_length = steps.angular_length();
+	path.deviation = steps.deviation();
 }
 
-units::length length_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns)
+path_soa expand_soa(const step_range& steps)
+{
+	path_soa path;
+	expand_into(path, steps);
+	return path;
+}
+
+void expand_into(path_soa& path, const step_range& steps)
+{
+	path.clear();
+	steps.append(path);
+	path.length = steps.length();
+	path.angular_length = steps.angular_length();
+	path.deviation = steps.deviation();
+}
+
+move_t::move_t()
+ : type(Type::Linear), start(), end(), center(), dir(ArcDirection::Clockwise), plane(0, 0, 1), turns(1)
+{
+}
+
+namespace
 {
-	static const double PI = 3.14159265358979323846;
-	static const units::plane_angle PI2_r( 2 * PI * units::radians );
 
-	auto helix_length = [](double r, double h, double p) -> double
+step_range move_range(const move_t& move, const limits::AvailableAxes& geometry, size_t steps_per_mm, const deviation_t* tolerance, arena* storage)
+{
+	if(tolerance)
+		check_tolerance(*tolerance);
+	switch(move.type)
 	{
-		double c = h / (2*PI);
-		auto l = (2*PI*p) * sqrt((r*r) + (c*c));
-		return l;
-	};
+		case move_t::Type::Linear:
+			return linear_range(move.start, move.end, geometry, steps_per_mm, tolerance, storage);
+		case move_t::Type::Rotary:
+			return rotary_range(move.start, move.end, geometry, steps_per_mm, tolerance, storage);
+		case move_t::Type::Arc:
+		{
+			arc_plan plan(move.start, move.end, move.center, move.dir, move.plane, move.turns);
+			if(tolerance)
+				return storage ? plan.steps(geometry, *tolerance, *storage) : plan.steps(geometry, *tolerance);
+			return storage ? plan.steps(geometry, steps_per_mm, *storage) : plan.steps(geometry, steps_per_mm);
+		}
+	}
+	throw std::logic_error("Unknown move type.");
+}
+
+}
+
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, size_t steps_per_mm)
+{
+	return move_range(move, geometry, steps_per_mm, nullptr, nullptr);
+}
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, size_t steps_per_mm, arena& storage)
+{
+	return move_range(move, geometry, steps_per_mm, nullptr, &storage);
+}
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	return move_range(move, geometry, 0, &tolerance, nullptr);
+}
+step_range move_steps(const move_t& move, const limits::AvailableAxes& geometry, const deviation_t& tolerance, arena& storage)
+{
+	return move_range(move, geometry, 0, &tolerance, &storage);
+}
+
+namespace
+{
+
+/*
+ * Planning (step counts) and expansion are separate parallel passes so each
+ * move can be written directly to its final offset in the program.
+ */
+template <typename Steps>
+program_t expand_moves(const std::vector<move_t>& moves, unsigned threads, Steps move_steps)
+{
+	static const std::size_t block = 256;
 	
-	math::point_3 arc_start;
-	math::point_3 arc_end;
-	units::length helix;
-	math::point_3 arc_center;
+	std::vector<step_range> ranges(moves.size());
 	
-	if(plane.z == 1)
+	parallel::for_blocks(moves.size(), block, threads, [&](std::size_t first, std::size_t last)
 	{
-		arc_start = math::point_3{start.X, start.Y, 0};
-		arc_end = math::point_3{end.X, end.Y, 0};
-		helix = units::length(end.Z - start.Z);
-		arc_center = math::point_3{center.X, center.Y, 0};
-	}
-	else if(plane.y == 1)
+		for(auto i = first; i != last; ++i)
+			ranges[i] = move_steps(moves[i]);
+	});
+	
+	program_t program;
+	program.offsets.reserve(moves.size());
+	std::size_t size = 0;
+	for(const auto& range : ranges)
 	{
-		arc_start = math::point_3{start.X, start.Z, 0};
-		arc_end = math::point_3{end.X, end.Z, 0};
-		helix = units::length(end.Y - start.Y);
-		arc_center = math::point_3{center.X, center.Z, 0};
+		program.offsets.push_back(size);
+		size += range.size();
+		
+		program.length += range.length();
+		program.angular_length += range.angular_length();
+		program.deviation.chordal = std::max(program.deviation.chordal, range.deviation().chordal);
+		program.deviation.angular = std::max(program.deviation.angular, range.deviation().angular);
 	}
-	else if(plane.x == 1)
+	program.path.resize(size);
+	
+	parallel::for_blocks(moves.size(), block, threads, [&](std::size_t first, std::size_t last)
 	{
-		arc_start = math::point_3{start.Z, start.Y, 0};
-		arc_end = math::point_3{end.Z, end.Y, 0};
-		helix = units::length(end.X - start.X);
-		arc_center = math::point_3{center.Z, center.Z, 0};
-	}
-	else
-		throw std::runtime_error("Unsupported Arc Plane");
+		for(auto i = first; i != last; ++i)
+			std::copy(ranges[i].begin(), ranges[i].end(), program.path.begin() + program.offsets[i]);
+	});
 	
-	if(!equidistant(arc_start, arc_end, arc_center, units::length{1e-6 * units::millimeters}))
-		throw std::runtime_error("Arc center not equidistant from start and end points.");
+	return program;
+}
 
-	auto r = distance(arc_start, arc_center);
-	auto start_theta = atan2(arc_start.y - arc_center.y, arc_start.x - arc_center.x);
-	auto end_theta = atan2(arc_end.y - arc_center.y, arc_end.x - arc_center.x);
-	auto turn_theta = PI2_r * (turns-1);
-	auto delta_theta = end_theta - start_theta;
-	switch(dir)
+}
+
+program_t expand_program(const std::vector<move_t>& moves, const limits::AvailableAxes& geometry, size_t steps_per_mm, unsigned threads)
+{
+	return expand_moves(moves, threads, [&](const move_t& move)
 	{
-		case ArcDirection::Clockwise:
-		{
-			if(delta_theta > units::plane_angle(0))
-				delta_theta -= PI2_r;
-			else if(delta_theta == units::plane_angle(0))
-				delta_theta = -PI2_r;
-			break;
-		}
-		case ArcDirection::CounterClockwise:
-		{
-			if(delta_theta < units::plane_angle(0))
-				delta_theta += PI2_r;
-			else if(delta_theta == units::plane_angle(0))
-				delta_theta = PI2_r;
-			break;
-		}
+		return move_steps(move, geometry, steps_per_mm);
+	});
+}
+program_t expand_program(const std::vector<move_t>& moves, const limits::AvailableAxes& geometry, const deviation_t& tolerance, unsigned threads)
+{
+	return expand_moves(moves, threads, [&](const move_t& move)
+	{
+		return move_steps(move, geometry, tolerance);
+	});
+}
+
+path_t expand_linear(const Position& start, const Position& end, const limits::AvailableAxes& geometry, ssize_t steps_per_mm)
+{
+	return expand(linear_steps(start, end, geometry, steps_per_mm));
+}
+
+path_t expand_linear(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	return expand(linear_steps(start, end, geometry, tolerance));
+}
+
+path_t expand_rotary(const Position& start, const Position& end, const limits::AvailableAxes& geometry, size_t steps_per_degree)
+{
+	return expand(rotary_steps(start, end, geometry, steps_per_degree));
+}
+path_t expand_rotary(const Position& start, const Position& end, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	return expand(rotary_steps(start, end, geometry, tolerance));
+}
+
+path_t expand_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, size_t steps_per_mm)
+{
+	return expand(arc_steps(start, end, center, dir, plane, turns, geometry, steps_per_mm));
+}
+path_t expand_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns, const limits::AvailableAxes& geometry, const deviation_t& tolerance)
+{
+	return expand(arc_steps(start, end, center, dir, plane, turns, geometry, tolerance));
+}
+
+units::length length_linear(const Position& start, const Position& end)
+{
+    return math::distance({start.X, start.Y, start.Z}, {end.X, end.Y, end.Z});
+}
+
+units::length length_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns)
+{
+	return arc_plan(start, end, center, dir, plane, turns).length();
+}
+
+Bbox bbox_linear(const Position& start, const Position& end)
+{
+	math::point_3 p0{start.X, start.Y, start.Z};
+	return Bbox{p0, p0} + math::point_3{end.X, end.Y, end.Z};
+}
+
+Bbox bbox_arc(const Position& start, const Position& end, const Position_Cartesian& center, ArcDirection dir, const math::vector_3& plane, double turns)
+{
+	return arc_plan(start, end, center, dir, plane, turns).bounding_box();
+}
+
+Bbox bbox_move(const move_t& move)
+{
+	switch(move.type)
+	{
+		case move_t::Type::Linear:
+		case move_t::Type::Rotary:
+			return bbox_linear(move.start, move.end);
+		case move_t::Type::Arc:
+			return bbox_arc(move.start, move.end, move.center, move.dir, move.plane, move.turns);
 	}
-	
-	turn_theta += fabs(delta_theta);
-	
-	return units::length(helix_length(units::length_mm(r).value(), units::length_mm{helix / units::plane_angle_rads{turn_theta}.value()}.value(), units::plane_angle_rads(turn_theta / (2*PI)).value()) * units::millimeters);
+	throw std::logic_error("Unknown move type.");
 }
 
 }
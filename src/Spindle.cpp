@@ -26,6 +26,9 @@
 #include <sstream>
 #include <cmath>
 #include <limits>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
 #include "cxxcam/Error.h"
 
 namespace cxxcam
@@ -166,6 +169,24 @@ units::torque Spindle::GetTorque(unsigned long speed) const
 	return torque_nm * units::newton_meters;
 }
 
+units::power Spindle::GetPower(unsigned long speed) const
+{
+	if(m_Power.empty())
+		return {};
+	
+	auto high = m_Power.lower_bound({speed, {}});
+	if(high == m_Power.end())
+		return std::prev(high)->power;
+	if(high->rpm == speed || high == m_Power.begin())
+		return high->power;
+	
+	auto low = std::prev(high);
+	auto x = static_cast<double>(speed);
+	auto x0 = low->rpm;
+	auto x1 = high->rpm;
+	return low->power + (high->power - low->power) * ((x - x0) / (x1 - x0));
+}
+
 void Spindle::AddRange(unsigned long range_start, unsigned long range_end)
 {
 	m_Speed.insert({range_start, range_end});
@@ -178,6 +199,10 @@ void Spindle::SetTorque(unsigned long rpm, units::torque torque)
 {
 	m_Torque.insert({rpm, torque});
 }
+void Spindle::SetPower(unsigned long rpm, units::power power)
+{
+	m_Power.insert({rpm, power});
+}
 
 std::string Spindle::str() const
 {
@@ -203,5 +228,213 @@ std::string Spindle::str() const
 	return s.str();
 }
 
+namespace
+{
+
+const double PI = 3.14159265358979323846;
+
+units::angular_velocity angular_velocity(unsigned long rpm)
+{
+	return units::angular_velocity::from_value(rpm * 2 * PI / 60.0);
+}
+
+}
+
+void spindle_table::curve::add(unsigned long r, double v)
+{
+	if(!rpm.empty())
+		slope.push_back((v - value.back()) / (static_cast<double>(r) - rpm.back()));
+	rpm.push_back(r);
+	value.push_back(v);
+}
+double spindle_table::curve::operator()(unsigned long speed) const
+{
+	if(speed <= rpm.front())
+		return value.front();
+	if(speed >= rpm.back())
+		return value.back();
+	
+	auto i = std::upper_bound(rpm.begin(), rpm.end(), speed) - rpm.begin() - 1;
+	return value[i] + slope[i] * (static_cast<double>(speed) - rpm[i]);
 }
 
+const unsigned long spindle_table::unattainable = std::numeric_limits<unsigned long>::max();
+
+spindle_table::spindle_table(const Spindle& spindle)
+ : m_Tolerance(spindle.m_Tolerance)
+{
+	for(auto& speed : spindle.m_Speed)
+	{
+		switch(speed.m_Type)
+		{
+			case Spindle::Speed::type_Range:
+				m_Low.push_back(speed.m_RangeStart);
+				m_High.push_back(speed.m_RangeEnd);
+				break;
+			case Spindle::Speed::type_Discrete:
+				m_Low.push_back(speed.m_Discrete);
+				m_High.push_back(speed.m_Discrete);
+				break;
+		}
+	}
+	
+	std::vector<std::size_t> order(m_Low.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return m_Low[a] < m_Low[b]; });
+	auto low = m_Low;
+	auto high = m_High;
+	for(std::size_t i = 0; i < order.size(); ++i)
+	{
+		m_Low[i] = low[order[i]];
+		m_High[i] = high[order[i]];
+	}
+	
+	m_Reach = m_High;
+	for(std::size_t i = 1; i < m_Reach.size(); ++i)
+		m_Reach[i] = std::max(m_Reach[i], m_Reach[i-1]);
+	
+	for(auto& sample : spindle.m_Torque)
+		m_Torque.add(sample.rpm, sample.torque.value());
+	for(auto& sample : spindle.m_Power)
+		m_Power.add(sample.rpm, sample.power.value());
+}
+
+unsigned long spindle_table::Closest(unsigned long requested_speed) const
+{
+	if(m_Low.empty())
+		return requested_speed;
+	
+	// First interval starting above the requested speed.
+	auto k = std::upper_bound(m_Low.begin(), m_Low.end(), requested_speed) - m_Low.begin();
+	if(k == 0)
+		return m_Low.front();
+	
+	// Intervals before k start at or below the requested speed so the
+	// closest of them is the one reaching furthest.
+	auto below = m_Reach[k-1];
+	if(below >= requested_speed)
+		return requested_speed;
+	if(static_cast<std::size_t>(k) == m_Low.size())
+		return below;
+	
+	auto above = m_Low[k];
+	if(above - requested_speed < requested_speed - below)
+		return above;
+	return below;
+}
+
+unsigned long spindle_table::Normalise(unsigned long requested_speed) const
+{
+	auto speed = Closest(requested_speed);
+	auto distance = speed > requested_speed ? speed - requested_speed : requested_speed - speed;
+	if(distance > m_Tolerance)
+	{
+		std::ostringstream s;
+		s << "Requested speed " << requested_speed << " outside of active tolerance (limit: " << m_Tolerance << "rpm; min: " << distance << ").";
+		throw error(s.str());
+	}
+	return speed;
+}
+
+std::size_t spindle_table::Normalise(const unsigned long* requested_speeds, std::size_t n, unsigned long* speeds) const
+{
+	std::size_t failed = 0;
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		auto requested = requested_speeds[i];
+		auto speed = Closest(requested);
+		auto distance = speed > requested ? speed - requested : requested - speed;
+		if(distance > m_Tolerance)
+		{
+			speed = unattainable;
+			++failed;
+		}
+		speeds[i] = speed;
+	}
+	return failed;
+}
+
+units::torque spindle_table::GetTorque(unsigned long speed) const
+{
+	units::torque torque;
+	GetTorque(&speed, 1, &torque);
+	return torque;
+}
+
+void spindle_table::GetTorque(const unsigned long* speeds, std::size_t n, units::torque* torque) const
+{
+	if(m_Torque.rpm.empty())
+	{
+		std::fill_n(torque, n, units::torque{});
+		return;
+	}
+	
+	if(m_Torque.rpm.size() < 2)
+		throw error("Need min & max torque samples at minimum");
+	
+	for(std::size_t i = 0; i < n; ++i)
+		torque[i] = units::torque::from_value(m_Torque(speeds[i]));
+}
+
+units::power spindle_table::GetPower(unsigned long speed) const
+{
+	units::power power;
+	GetPower(&speed, 1, &power);
+	return power;
+}
+
+void spindle_table::GetPower(const unsigned long* speeds, std::size_t n, units::power* power) const
+{
+	if(m_Power.rpm.empty())
+	{
+		std::fill_n(power, n, units::power{});
+		return;
+	}
+	
+	for(std::size_t i = 0; i < n; ++i)
+		power[i] = units::power::from_value(m_Power(speeds[i]));
+}
+
+units::torque spindle_table::AvailableTorque(unsigned long speed) const
+{
+	auto torque = std::numeric_limits<double>::infinity();
+	if(!m_Torque.rpm.empty())
+		torque = GetTorque(speed).value();
+	if(!m_Power.rpm.empty() && speed > 0)
+		torque = std::min(torque, m_Power(speed) / angular_velocity(speed).value());
+	return units::torque::from_value(torque);
+}
+
+std::vector<spindle_overload> spindle_table::Overloads(const std::vector<spindle_load>& loads) const
+{
+	std::vector<spindle_overload> overloads;
+	for(std::size_t i = 0; i < loads.size(); ++i)
+	{
+		auto& load = loads[i];
+		auto speed = Closest(load.rpm);
+		auto distance = speed > load.rpm ? speed - load.rpm : load.rpm - speed;
+		auto attainable = distance <= m_Tolerance;
+		
+		// At the requested speed when it cannot be run.
+		auto required = load.torque;
+		if(load.power > units::power{})
+		{
+			// Any power at standstill needs unbounded torque.
+			auto omega = angular_velocity(attainable ? speed : load.rpm).value();
+			required = std::max(required, units::torque::from_value(omega > 0 ? load.power.value() / omega : std::numeric_limits<double>::infinity()));
+		}
+		
+		if(!attainable)
+		{
+			overloads.push_back({i, unattainable, required, {}});
+			continue;
+		}
+		
+		auto available = AvailableTorque(speed);
+		if(required > available)
+			overloads.push_back({i, speed, required, available});
+	}
+	return overloads;
+}
+
+}
@@ -1,18 +1,60 @@
 #include "Limits.h"
+#include "Error.h"
+#include "die_if.h"
+#include <vector>
+#include <algorithm>
 
 using namespace cxxcam;
 using namespace cxxcam::limits;
 
+static_assert(is_pure_xyz(xyz_mask), "XYZ is pure xyz");
+static_assert(!is_pure_xyz(xyz_mask | axis_mask(Axis::Type::A)), "XYZA is not pure xyz");
+static_assert(has_rotary(axis_mask(Axis::Type::C)), "C is rotary");
+static_assert(!has_rotary(axis_mask(Axis::Type::U)), "U is not rotary");
+
 int main()
 {
 	{
 		AvailableAxes x;
 		x.Validate(Axis::Type::X);
+		die_if(!has_rotary(x), "Default axes have rotary axes");
 	}
 	
 	{
 		AvailableAxes x({Axis::Type::X, Axis::Type::Y});
 		x.Validate(Axis::Type::X);
+		die_if(is_pure_xyz(x), "XY is not pure xyz");
+		
+		bool thrown = false;
+		try
+		{
+			x.Validate(Axis::Type::Z);
+		}
+		catch(const error&)
+		{
+			thrown = true;
+		}
+		die_if(!thrown, "Missing axis not rejected");
+	}
+	
+	{
+		std::vector<Axis::Type> order{Axis::Type::C, Axis::Type::X, Axis::Type::Y, Axis::Type::Z, Axis::Type::A};
+		AvailableAxes x(order);
+		die_if(!std::equal(order.begin(), order.end(), x.begin()) || x.end() - x.begin() != 5, "Machine order not kept");
+		die_if(!has_rotary(x) || is_pure_xyz(x), "Incorrect rotary classification");
+	}
+	
+	{
+		bool thrown = false;
+		try
+		{
+			AvailableAxes x({Axis::Type::X, Axis::Type::X});
+		}
+		catch(const error&)
+		{
+			thrown = true;
+		}
+		die_if(!thrown, "Repeated axis not rejected");
 	}
 	return 0;
 }
@@ -1,6 +1,46 @@
 #include "Bbox.h"
 #include <iostream>
 #include "die_if.h"
+#include <random>
+
+void reduction()
+{
+	using namespace cxxcam;
+	using namespace cxxcam::math;
+	
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dist(-1, 1);
+	
+	// Larger than a block so the parallel reduction combines partial boxes.
+	const std::size_t n = 300001;
+	std::vector<point_3> points;
+	std::vector<double> x, y, z;
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		x.push_back(dist(gen));
+		y.push_back(dist(gen) * 2);
+		z.push_back(dist(gen) + 5);
+		points.push_back({units::length::from_value(x.back()), units::length::from_value(y.back()), units::length::from_value(z.back())});
+	}
+	
+	Bbox expected{points.front(), points.front()};
+	for(auto& p : points)
+		expected += p;
+	
+	die_if(construct(points) != expected, "Incorrect point extent");
+	die_if(construct(points, 4) != expected, "Incorrect parallel point extent");
+	die_if(construct(x.data(), y.data(), z.data(), n) != expected, "Incorrect array extent");
+	die_if(construct(x.data(), y.data(), z.data(), n, 4) != expected, "Incorrect parallel array extent");
+	
+	for(std::size_t m : {1, 3, 7, 9})
+	{
+		Bbox e{points.front(), points.front()};
+		for(std::size_t i = 0; i < m; ++i)
+			e += points[i];
+		die_if(construct(x.data(), y.data(), z.data(), m) != e, "Incorrect short array extent");
+	}
+	die_if(construct(nullptr, nullptr, nullptr, 0) != Bbox{}, "Incorrect empty extent");
+}
 
 int main()
 {
@@ -17,6 +57,8 @@ int main()
 	
 	die_if(b != Bbox{ {units::length{0*mm}, units::length{0*mm}, units::length{0*mm}}, {units::length{1*mm}, units::length{1*mm}, units::length{1*mm}}});
 	
+	reduction();
+	
 	return 0;
 }
 
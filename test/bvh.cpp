@@ -0,0 +1,186 @@
+#include "Bvh.h"
+#include <iostream>
+#include "die_if.h"
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+using namespace cxxcam;
+using namespace cxxcam::path;
+
+namespace
+{
+
+units::length mm(double v)
+{
+	return units::length{v * units::millimeters};
+}
+
+math::point_3 point(double x, double y, double z)
+{
+	return {mm(x), mm(y), mm(z)};
+}
+
+/*
+ * Exact distance from p to segment (s, e) by projection onto the segment.
+ */
+double segment_distance(const math::point_3& p, const math::point_3& s, const math::point_3& e)
+{
+	double d[3] = {(e.x - s.x).value(), (e.y - s.y).value(), (e.z - s.z).value()};
+	double w[3] = {(p.x - s.x).value(), (p.y - s.y).value(), (p.z - s.z).value()};
+	auto dd = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+	auto t = dd > 0 ? std::max(0.0, std::min(1.0, (w[0]*d[0] + w[1]*d[1] + w[2]*d[2]) / dd)) : 0.0;
+	double r = 0;
+	for(int i = 0; i < 3; ++i)
+		r += (w[i] - t * d[i]) * (w[i] - t * d[i]);
+	return std::sqrt(r);
+}
+
+math::point_3 lerp(const math::point_3& s, const math::point_3& e, double t)
+{
+	return {s.x + (e.x - s.x) * t, s.y + (e.y - s.y) * t, s.z + (e.z - s.z) * t};
+}
+
+double box_distance(const Bbox& b, const math::point_3& q)
+{
+	auto gap = [](double v, double lo, double hi) { return std::max(std::max(lo - v, v - hi), 0.0); };
+	auto dx = gap(q.x.value(), b.min.x.value(), b.max.x.value());
+	auto dy = gap(q.y.value(), b.min.y.value(), b.max.y.value());
+	auto dz = gap(q.z.value(), b.min.z.value(), b.max.z.value());
+	return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+/*
+ * Whether segment (s, e) touches the closed box, by clipping against each
+ * pair of slabs.
+ */
+bool segment_touches(const Bbox& b, const math::point_3& s, const math::point_3& e)
+{
+	double lo[3] = {b.min.x.value(), b.min.y.value(), b.min.z.value()};
+	double hi[3] = {b.max.x.value(), b.max.y.value(), b.max.z.value()};
+	double p[3] = {s.x.value(), s.y.value(), s.z.value()};
+	double d[3] = {(e.x - s.x).value(), (e.y - s.y).value(), (e.z - s.z).value()};
+	double t0 = 0;
+	double t1 = 1;
+	for(int i = 0; i < 3; ++i)
+	{
+		if(d[i] == 0)
+		{
+			if(p[i] < lo[i] || p[i] > hi[i])
+				return false;
+			continue;
+		}
+		auto ta = (lo[i] - p[i]) / d[i];
+		auto tb = (hi[i] - p[i]) / d[i];
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+	}
+	return t0 <= t1;
+}
+
+/*
+ * Exact distance from segment (s, e) to the box. The distance to a convex
+ * set is convex along the segment, so a ternary search converges on the
+ * minimum.
+ */
+double segment_box_distance(const Bbox& b, const math::point_3& s, const math::point_3& e)
+{
+	if(segment_touches(b, s, e))
+		return 0;
+	double lo = 0;
+	double hi = 1;
+	for(int k = 0; k < 200; ++k)
+	{
+		auto m1 = lo + (hi - lo) / 3;
+		auto m2 = hi - (hi - lo) / 3;
+		if(box_distance(b, lerp(s, e, m1)) < box_distance(b, lerp(s, e, m2)))
+			hi = m2;
+		else
+			lo = m1;
+	}
+	return box_distance(b, lerp(s, e, (lo + hi) / 2));
+}
+
+}
+
+int main()
+{
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<double> offset(-1, 1);
+	
+	segment_bvh bvh;
+	die_if(!bvh.empty() || bvh.first_entering({point(-1, -1, -1), point(1, 1, 1)}) != segment_bvh::npos, "Empty hierarchy not empty");
+	
+	// Random walk appended in moves of varying length, as a program is expanded.
+	std::vector<step> path;
+	math::point_3 p = point(0, 0, 0);
+	for(int move = 0; move < 100; ++move)
+	{
+		std::vector<step> steps;
+		for(int i = 0; i < 1 + move % 13; ++i)
+		{
+			p.x += mm(offset(gen));
+			p.y += mm(offset(gen));
+			p.z += mm(offset(gen) * 0.2);
+			step s;
+			s.position = p;
+			steps.push_back(s);
+		}
+		bvh.append(steps);
+		path.insert(path.end(), steps.begin(), steps.end());
+		
+		die_if(bvh.size() != path.size() - 1, "Incorrect segment count");
+		if(bvh.empty())
+			continue;
+		std::vector<math::point_3> points;
+		for(auto& s : path)
+			points.push_back(s.position);
+		die_if(bvh.bounds() != construct(points), "Incorrect hierarchy bounds after append");
+	}
+	die_if(segment_bvh(path).bounds() != bvh.bounds(), "Incremental build differs");
+	
+	// Queries agree with a linear scan. Segments within rounding of distance
+	// d may fall either way so are excluded from the comparison.
+	const auto d = 0.75;
+	for(int q = 0; q < 50; ++q)
+	{
+		auto c = path[(q * 37) % path.size()].position;
+		c.x += mm(offset(gen));
+		c.y += mm(offset(gen));
+		auto hits = bvh.within(c, mm(d));
+		for(std::size_t i = 0; i < bvh.size(); ++i)
+		{
+			auto dist = units::length_mm(units::length::from_value(segment_distance(c, bvh.start(i), bvh.end(i)))).value();
+			auto hit = std::binary_search(hits.begin(), hits.end(), i);
+			die_if(dist < d - 1e-6 && !hit, "Point query missed segment");
+			die_if(dist > d + 1e-6 && hit, "Point query returned distant segment");
+		}
+		
+		Bbox region{c, {c.x + mm(0.5), c.y + mm(0.25), c.z + mm(0.1)}};
+		hits = bvh.within(region, mm(d));
+		for(std::size_t i = 0; i < bvh.size(); ++i)
+		{
+			auto dist = units::length_mm(units::length::from_value(segment_box_distance(region, bvh.start(i), bvh.end(i)))).value();
+			auto hit = std::binary_search(hits.begin(), hits.end(), i);
+			die_if(dist < d - 1e-6 && !hit, "Box query missed segment");
+			die_if(dist > d + 1e-6 && hit, "Box query returned distant segment");
+		}
+		
+		auto first = bvh.first_entering(region);
+		for(std::size_t i = 0; i < std::min(first, bvh.size()); ++i)
+			die_if(segment_touches(region, bvh.start(i), bvh.end(i)), "Region entered before first segment");
+		if(first != segment_bvh::npos)
+			die_if(!segment_touches(region, bvh.start(first), bvh.end(first)), "First segment does not enter region");
+	}
+	
+	// A path crossing a region without a vertex inside it.
+	segment_bvh line;
+	line.append(point(-10, 0, 0));
+	line.append(point(-5, 0, 0));
+	line.append(point(5, 0, 0));
+	die_if(line.first_entering({point(-1, -1, -1), point(1, 1, 1)}) != 1, "Crossing segment not found");
+	die_if(line.within(point(0, 2, 0), mm(2)).size() != 1, "Nearby segment not found");
+	die_if(!line.within(point(0, 2, 0), mm(1.9)).empty(), "Distant segment found");
+	
+	return 0;
+}
@@ -0,0 +1,411 @@
+#include "GCodeWord.h"
+#include "GCodeLine.h"
+#include "GCodeWriter.h"
+#include "GCodeParser.h"
+#include "GCodeInterpreter.h"
+#include "Path.h"
+#include "Error.h"
+#include <fstream>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+#include "die_if.h"
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <string>
+
+using namespace cxxcam;
+using namespace cxxcam::gcode;
+
+/*
+ * Word formatting through iostreams.
+ */
+std::string reference(const Word& word)
+{
+	std::ostringstream os;
+	os << to_string(word);
+	{
+		std::ostringstream ss;
+		ss << std::fixed << std::setprecision(6) << word.Value();
+		auto s = ss.str();
+		
+		s.erase(s.find_last_not_of('0') + 1, std::string::npos);
+		if(s.back() == '.')
+			s.pop_back();
+		os << s;
+	}
+	if(!word.Comment().empty())
+		os << " (" << word.Comment() << ")";
+	return os.str();
+}
+
+void check(const Word& word)
+{
+	char buffer[512];
+	auto n = format(buffer, sizeof(buffer), word);
+	auto expected = reference(word);
+	die_if(std::string(buffer, n) != expected, "Formatted word differs from iostreams: " + expected);
+	
+	std::ostringstream os;
+	os << word;
+	die_if(os.str() != expected, "Streamed word differs from iostreams: " + expected);
+}
+
+void test_writer()
+{
+	std::vector<Line> program;
+	std::string expected;
+	for(int i = 0; i < 1000; ++i)
+	{
+		Line line(Word(Word::G, 1));
+		line += Word(Word::X, i * 0.125);
+		line += Word(Word::Y, -i / 3.0);
+		if(i % 100 == 0)
+			line.Comment(std::string(i / 10, 'c'));
+		program.push_back(line);
+		expected += line.debug_str();
+	}
+	program.push_back(Line("end"));
+	expected += program.back().debug_str();
+	
+	// Small buffer so lines straddle flushes and some exceed the buffer.
+	std::ostringstream os;
+	{
+		Writer writer(os, 64);
+		for(auto& line : program)
+			writer << line;
+		die_if(writer.Lines() != program.size() || writer.Bytes() != expected.size(), "Incorrect writer totals");
+	}
+	die_if(os.str() != expected, "Written program differs");
+	
+	auto file = std::tmpfile();
+	die_if(!file, "Unable to create temporary file");
+	{
+		Writer writer(fileno(file));
+		for(auto& line : program)
+			writer.Write(line);
+		writer.Flush();
+	}
+	std::rewind(file);
+	std::string written;
+	char buffer[4096];
+	std::size_t n;
+	while((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		written.append(buffer, n);
+	std::fclose(file);
+	die_if(written != expected, "Written file differs");
+}
+
+void test_parser()
+{
+	// Round trip of the written form.
+	std::string text;
+	std::vector<std::string> expected;
+	std::mt19937 gen(2);
+	std::uniform_real_distribution<double> coord(-2000, 2000);
+	for(int i = 0; i < 2000; ++i)
+	{
+		Line line(Word(Word::G, i % 4));
+		line += Word(Word::X, coord(gen));
+		line += Word(Word::Y, coord(gen), i % 7 == 0 ? "word comment" : "");
+		line += Word(Word::F, 1e-7 * i);
+		if(i % 5 == 0)
+			line.Comment("line comment");
+		expected.push_back(line.debug_str());
+		text += expected.back();
+	}
+	
+	auto program = parse(text);
+	die_if(program.size() != expected.size(), "Incorrect parsed line count");
+	for(std::size_t i = 0; i < program.size(); ++i)
+	{
+		die_if(program.lines[i].number != i + 1, "Incorrect source line number");
+		die_if(program.line(i).debug_str() != expected[i], "Parsed line differs: " + expected[i]);
+	}
+	
+	// Numbers agree with strtod.
+	for(auto number : {"0", "-0.5", "+12.25", ".5", "5.", "007.0100", "123456.789012", "-0.000001", "99999999999999.9", "0.30000000000000004"})
+	{
+		auto p = parse(std::string("X") + number);
+		die_if(p.words.size() != 1 || p.words[0].value != std::strtod(number, nullptr), std::string("Incorrect number ") + number);
+	}
+	
+	program = parse("%\r\nn10 g1 x 1.5 Y-2 (move)(fast) ; to the end\r\n\n(only a comment)\n/M3 S1000\n%");
+	die_if(program.size() != 3, "Incorrect line count");
+	die_if(program.line(0).debug_str() != "G1 X1.5 Y-2 (move fast) ; to the end\n", "Incorrect parsed line: " + program.line(0).debug_str());
+	die_if(program.lines[1].number != 4 || program.line(1).debug_str() != "; only a comment\n", "Incorrect comment line");
+	die_if(program.lines[2].number != 5 || program.line(2).debug_str() != "M3 S1000\n", "Block delete not skipped");
+	
+	for(auto bad : {"G1 X", "G1 E5", "G1 X#1", "G1 (open", "G1 X[1+2]"})
+	{
+		bool thrown = false;
+		try
+		{
+			parse(bad);
+		}
+		catch(const error&)
+		{
+			thrown = true;
+		}
+		die_if(!thrown, std::string("Malformed G-code not rejected: ") + bad);
+	}
+	
+	const char* filename = "gcode_test.ngc";
+	{
+		std::ofstream os(filename);
+		os << text;
+	}
+	program = parse_file(filename);
+	std::remove(filename);
+	die_if(program.size() != expected.size() || program.line(10).debug_str() != expected[10], "Incorrect parsed file");
+}
+
+void test_parallel()
+{
+	// Large enough to be split into several chunks.
+	std::string text;
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<double> coord(-500, 500);
+	for(int i = 0; i < 200000; ++i)
+	{
+		Line line(Word(Word::G, 1));
+		line += Word(Word::X, coord(gen));
+		line += Word(Word::Y, coord(gen), i % 11 == 0 ? "y" : "");
+		if(i % 13 == 0)
+			line.Comment("line " + std::to_string(i));
+		text += line.debug_str();
+		if(i % 17 == 0)
+			text += "\n";
+	}
+	
+	auto sequential = parse(text);
+	auto parallel = parse(text, 4);
+	die_if(parallel.size() != sequential.size() || parallel.words.size() != sequential.words.size() || parallel.comments != sequential.comments, "Parallel parse differs");
+	for(std::size_t i = 0; i < sequential.size(); ++i)
+	{
+		auto& a = sequential.lines[i];
+		auto& b = parallel.lines[i];
+		die_if(a.first != b.first || a.count != b.count || a.number != b.number || a.comment != b.comment, "Parallel parse line differs");
+	}
+	for(std::size_t i = 0; i < sequential.words.size(); ++i)
+	{
+		auto& a = sequential.words[i];
+		auto& b = parallel.words[i];
+		die_if(a.code != b.code || a.value != b.value || a.comment != b.comment, "Parallel parse word differs");
+	}
+	
+	// Errors report the source line of the whole text.
+	auto lines = std::count(text.begin(), text.end(), '\n');
+	text += "G1 E1\n";
+	std::string what;
+	try
+	{
+		parse(text, 4);
+	}
+	catch(const error& ex)
+	{
+		what = ex.what();
+	}
+	die_if(what.find("line " + std::to_string(lines + 1) + ":") == std::string::npos, "Incorrect error line: " + what);
+}
+
+void test_resolve()
+{
+	auto program = parse(
+		"G0 X10 Y20 F100\n"
+		"G91 X5 A90\n"
+		"X5 Z-1 (incremental)\n"
+		"G20 G90 X1 F10\n"
+		"G21 G91 Y1\n");
+	auto positions = resolve(program);
+	die_if(positions.size() != 5, "Incorrect resolved position count");
+	
+	auto mm = [](double v) { return units::length{v * units::millimeters}; };
+	auto near = [](units::length a, units::length b) { return std::abs((a - b).value()) < 1e-12; };
+	die_if(!near(positions[0].X, mm(10)) || !near(positions[0].Y, mm(20)), "Incorrect absolute position");
+	die_if(!near(positions[1].X, mm(15)) || std::abs(positions[1].A.value() - 3.14159265358979323846 / 2) > 1e-12, "Incorrect incremental position");
+	die_if(!near(positions[2].X, mm(20)) || !near(positions[2].Z, mm(-1)), "Incorrect incremental position");
+	die_if(!near(positions[3].X, mm(25.4)) || !near(positions[3].Y, mm(20)), "Incorrect inch position");
+	die_if(!near(positions[4].Y, mm(21)) || !near(positions[4].X, mm(25.4)), "Incorrect metric incremental position");
+	
+	modal_t state;
+	for(std::size_t i = 0; i < 4; ++i)
+		state.apply(program, i);
+	die_if(std::abs(state.feed.value() - units::velocity{254 * units::millimeters_per_minute}.value()) > 1e-12, "Incorrect inch feed rate");
+}
+
+void test_interpreter()
+{
+	auto text =
+		"G21 G90 G17\n"
+		"G0 X0 Y0 Z5\n"
+		"G1 Z0 F300\n"
+		"M3 S1200\n"
+		"G2 X10 Y0 I5 J0\n"
+		"G3 X0 Y10 R10 (quarter)\n"
+		"G1 Y10\n"
+		"A90\n"
+		"G91 X1\n"
+		"G90 G2 X1 Y0 I0.0001 J-5.0001 P2\n"
+		"G18 G3 X6 Z0 I2.5 K0\n";
+	auto program = parse(text);
+	
+	Interpreter interpreter;
+	auto motions = interpreter.Run(program);
+	die_if(motions.size() != 8, "Incorrect move count");
+	
+	auto mm = [](double v) { return units::length{v * units::millimeters}; };
+	auto near = [](units::length a, units::length b) { return std::abs((a - b).value()) < 1e-12; };
+	
+	die_if(!motions[0].rapid || !near(motions[0].move.end.Z, mm(5)) || motions[0].line != 1, "Incorrect rapid");
+	die_if(motions[1].rapid || std::abs(motions[1].feed.value() - units::velocity{300 * units::millimeters_per_minute}.value()) > 1e-12, "Incorrect feed move");
+	
+	auto& arc = motions[2];
+	die_if(arc.move.type != path::move_t::Type::Arc || arc.move.dir != path::ArcDirection::Clockwise, "Incorrect arc");
+	die_if(!near(arc.move.center.X, mm(5)) || !near(arc.move.center.Y, mm(0)), "Incorrect IJ arc center");
+	die_if(arc.speed != 1200 || arc.spindle != Interpreter::SpindleDirection::Clockwise, "Incorrect spindle state");
+	
+	auto& r = motions[3];
+	die_if(r.move.dir != path::ArcDirection::CounterClockwise || !near(r.move.center.X, mm(0)) || !near(r.move.center.Y, mm(0)), "Incorrect R arc center");
+	
+	// G1 Y10 does not move.
+	die_if(motions[4].move.type != path::move_t::Type::Rotary || motions[4].line != 7, "Incorrect rotary move");
+	die_if(!near(motions[5].move.end.X, mm(1)), "Incorrect incremental move");
+	
+	auto& turns = motions[6];
+	die_if(turns.move.turns != 2 || !near(turns.move.center.X, mm(1.0001)) || !near(turns.move.center.Y, mm(5)), "Arc center not corrected");
+	
+	auto& zx = motions[7];
+	die_if(zx.move.plane != math::vector_3(0, 1, 0) || !near(zx.move.center.X, mm(3.5)) || !near(zx.move.center.Z, mm(0)), "Incorrect ZX arc");
+	
+	// Moves drive path expansion.
+	std::vector<path::move_t> moves;
+	for(auto& motion : motions)
+		moves.push_back(motion.move);
+	auto expanded = path::expand_program(moves, limits::AvailableAxes(), 10, 1);
+	die_if(expanded.offsets.size() != moves.size() || expanded.path.empty(), "Interpreted moves not expanded");
+	
+	// Line input is interpreted identically.
+	std::vector<Line> lines;
+	for(std::size_t i = 0; i < program.size(); ++i)
+		lines.push_back(program.line(i));
+	auto from_lines = Interpreter().Run(lines);
+	die_if(from_lines.size() != motions.size(), "Line input differs");
+	for(std::size_t i = 0; i < motions.size(); ++i)
+		die_if(from_lines[i].move.end != motions[i].move.end || from_lines[i].move.center.X != motions[i].move.center.X || from_lines[i].line != motions[i].line, "Line input differs");
+	
+	die_if(Interpreter().Run(parse("G17 G40 G49 G80 G90 G92.1\nG1 X1\n")).size() != 1, "Cancel codes not accepted");
+	
+	// P belongs to dwells and blending; only on an arc move is it turns.
+	auto p_words = Interpreter().Run(parse(
+		"G17 G1 X0 Y0 F100\n"
+		"G64 P0.01\n"
+		"G3 X1 Y1 I1\n"
+		"G4 P0.5\n"
+		"G4 P2\n"
+		"G3 X2 Y0 J-1 P2\n"
+		"G64 P0.02 G3 X1 Y-1 I-1\n"
+		"G1 X0 P2\n"));
+	die_if(p_words.size() != 4, "Incorrect move count with P words");
+	die_if(p_words[0].move.turns != 1 || p_words[1].move.turns != 2 || p_words[2].move.turns != 1, "P words taken as arc turns");
+	die_if(p_words[3].move.type != path::move_t::Type::Linear, "Incorrect linear move with P word");
+	
+	// G2 / G3 are viewed from the positive end of the plane normal.
+	struct arc_case
+	{
+		const char* text;
+		double a;
+		double b;
+	};
+	for(auto& arc : {
+			arc_case{"G17 G0 X1 Y0\nG3 X0 Y1 I-1\n", 0, 0},
+			arc_case{"G17 G0 X1 Y0\nG3 X0 Y1 R1\n", 0, 0},
+			arc_case{"G18 G0 X1 Z0\nG3 X0 Z-1 I-1\n", 0, 0},
+			arc_case{"G18 G0 X1 Z0\nG3 X0 Z-1 R1\n", 0, 0},
+			arc_case{"G18 G0 X1 Z0\nG2 X0 Z1 R1\n", 0, 0},
+			arc_case{"G18 G0 X2 Z1\nG2 X1 Z2 I-1\n", 1, 1},
+			arc_case{"G19 G0 Y1 Z0\nG3 Y0 Z1 J-1\n", 0, 0},
+			arc_case{"G19 G0 Y1 Z0\nG3 Y0 Z1 R1\n", 0, 0},
+			arc_case{"G19 G0 Y1 Z0\nG2 Y0 Z-1 R1\n", 0, 0},
+			arc_case{"G19 G0 Y2 Z1\nG2 Y1 Z0 J-1\n", 1, 1}})
+	{
+		auto moves = Interpreter().Run(parse(arc.text));
+		die_if(moves.size() != 2, std::string("Incorrect move count: ") + arc.text);
+		auto& m = moves[1].move;
+		auto span = path::arc_plan(m.start, m.end, m.center, m.dir, m.plane, m.turns).angular_span().value();
+		die_if(std::abs(span - 3.14159265358979323846 / 2) > 1e-12, std::string("Incorrect arc direction: ") + arc.text);
+		
+		// Center in the plane's first and second axes (X, Y / X, Z / Y, Z).
+		auto zx = m.plane == math::vector_3(0, 1, 0);
+		auto yz = m.plane == math::vector_3(1, 0, 0);
+		auto ca = yz ? m.center.Y : m.center.X;
+		auto cb = (zx || yz) ? m.center.Z : m.center.Y;
+		die_if(!near(ca, mm(arc.a)) || !near(cb, mm(arc.b)), std::string("Incorrect arc center: ") + arc.text);
+	}
+	
+	for(auto bad : {"X1\n", "G0 X0\nG92 X1\n", "G1 X0\nG2 X10\n", "G1 X0 Y0\nG2 X10 I1\n", "G1 X0\nG2 X10 R1\n",
+	                "G54\n", "G59.1\n", "G52 X1\n", "G43 H1\n", "G41 D1\n", "G95\n",
+	                "G1 X0 Y0\nG2 X0 Y0 I1 P1.5\n", "G1 X0 Y0\nG2 X0 Y0 I1 P0\n", "G1 X0 Y0\nG3 X0 Y0 I1 P-2\n",
+	                "G5 X1 Y1 I1 J1 P1 Q1\n", "G5.1 X1 I1 J1\n", "G33.1 Z-5 K1\n", "G92.3\n"})
+	{
+		bool thrown = false;
+		try
+		{
+			Interpreter().Run(parse(bad));
+		}
+		catch(const error&)
+		{
+			thrown = true;
+		}
+		die_if(!thrown, std::string("Invalid G-code not rejected: ") + bad);
+	}
+}
+
+int main()
+{
+	std::vector<double> values{0.0, -0.0, 1.0, -1.0, 10.0, 100.5, 0.1, 0.0000005, -0.0000004, 0.0000015, 0.9999995, 0.9999994999,
+		1e-7, 123456.789012345, 4503599627.370495, 4503599627.370497, 1e20, -1e300,
+		std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min(),
+		std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()};
+	
+	// Exact decimal ties of the sixth place round half to even.
+	for(int k = 0; k < 2000; ++k)
+		values.push_back((2 * k + 1) * 15625 / 2e6);
+	
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> coord(-2000, 2000);
+	std::uniform_int_distribution<int> micro(-2000000000, 2000000000);
+	for(int i = 0; i < 100000; ++i)
+	{
+		values.push_back(coord(gen));
+		values.push_back(micro(gen) / 1e6);
+		values.push_back((micro(gen) + 0.5) / 1e6);
+	}
+	
+	for(auto v : values)
+		check(Word(Word::X, v));
+	
+	for(int code = Word::A; code <= Word::Z; ++code)
+		check(Word(static_cast<Word::Code>(code), 12.5, "comment"));
+	check(Word(Word::G, 1, std::string(300, 'c')));
+	
+	char small[4];
+	Word w(Word::X, 12.5);
+	die_if(format(small, sizeof(small), w) != 5, "Incorrect length of truncated word");
+	die_if(format(small, 0, w) != 5, "Incorrect length of truncated word");
+	
+	Line line(Word(Word::G, 0), "rapid");
+	line += Word(Word::X, -0.25);
+	die_if(line.debug_str() != "G0 X-0.25 ; rapid\n", "Incorrect line");
+	die_if(Line("comment").debug_str() != "; comment\n" || Line().debug_str() != "\n", "Incorrect comment line");
+	
+	test_writer();
+	test_parser();
+	test_parallel();
+	test_resolve();
+	test_interpreter();
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include "Material.h"
+#include "Error.h"
+#include "die_if.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+using namespace cxxcam;
+using namespace cxxcam::material;
+
+void test_parse()
+{
+	const char* text =
+		"# name,grade,hardness,machinability,hss,carbide\n"
+		"Aluminium,6061-T6,95,1.9,75-105,\n"
+		"\n"
+		"Steel, Mild , 120-180 ,,30-38,90-120\r\n"
+		"Brass,,,,90-210";
+	
+	MaterialTable table;
+	table.Parse(text, std::strlen(text));
+	die_if(table.size() != 3, "Incorrect material count");
+	
+	auto al = table.Find("Aluminium", "6061-T6");
+	die_if(al == MaterialTable::npos, "Material not found");
+	die_if(table.Get(al).hardness.low != 95 || table.Get(al).machinability.high != 1.9, "Incorrect material properties");
+	
+	Material::range_t<double> surface;
+	die_if(!table.SurfaceSpeed(al, Material::Tool::HSS, surface) || surface.low != 75 || surface.high != 105, "Incorrect HSS surface speed");
+	die_if(table.SurfaceSpeed(al, Material::Tool::Carbide, surface), "Unset surface speed found");
+	
+	auto steel = table.Find("Steel", "Mild");
+	die_if(steel == MaterialTable::npos, "Fields not trimmed");
+	die_if(!table.SurfaceSpeed(steel, Material::Tool::Carbide, surface) || surface.high != 120, "Incorrect carbide surface speed");
+	
+	die_if(table.Find("Brass", "") == MaterialTable::npos, "Material without grade not found");
+	die_if(table.Find("Aluminium", "") != MaterialTable::npos, "Grade ignored");
+	
+	// Reloading replaces the material under the same id.
+	const char* update = "Aluminium,6061-T6,95,1.9,80-110,200-300\n";
+	table.Parse(update, std::strlen(update));
+	die_if(table.size() != 3 || table.Find("Aluminium", "6061-T6") != al, "Material not replaced");
+	die_if(!table.SurfaceSpeed(al, Material::Tool::Carbide, surface) || surface.low != 200, "Replaced surface speed not found");
+	
+	for(auto bad : {"Aluminium,6061-T6,hard\n", "a,b,1,2,3,4,5\n", ",grade\n"})
+	{
+		bool thrown = false;
+		try
+		{
+			table.Parse(bad, std::strlen(bad));
+		}
+		catch(const error&)
+		{
+			thrown = true;
+		}
+		die_if(!thrown, "Malformed line not rejected");
+	}
+	
+	// A failed parse leaves the table as it was.
+	const char* partial = "Copper,C110,40,0.2,,\nAluminium,6061-T6,1,1,1,1\nBronze,,x\n";
+	bool thrown = false;
+	try
+	{
+		table.Parse(partial, std::strlen(partial));
+	}
+	catch(const error&)
+	{
+		thrown = true;
+	}
+	die_if(!thrown, "Malformed text not rejected");
+	die_if(table.size() != 3 || table.Find("Copper", "C110") != MaterialTable::npos, "Failed parse added materials");
+	die_if(table.Get(al).hardness.low != 95 || !table.SurfaceSpeed(al, Material::Tool::Carbide, surface) || surface.low != 200, "Failed parse replaced material");
+	
+	thrown = false;
+	try
+	{
+		table.SurfaceSpeed(MaterialTable::npos, Material::Tool::HSS, surface);
+	}
+	catch(const error&)
+	{
+		thrown = true;
+	}
+	die_if(!thrown, "Invalid id not rejected");
+}
+
+void test_load()
+{
+	const char* filename = "material_test.csv";
+	{
+		std::ofstream os(filename);
+		for(int i = 0; i < 1000; ++i)
+			os << "Material" << i << ",grade,100,1," << i << "-" << i + 10 << ",\n";
+	}
+	
+	MaterialTable table;
+	table.Load(filename);
+	std::remove(filename);
+	die_if(table.size() != 1000, "Incorrect loaded material count");
+	
+	Material::range_t<double> surface;
+	auto id = table.Find("Material500", "grade");
+	die_if(!table.SurfaceSpeed(id, Material::Tool::HSS, surface) || surface.low != 500 || surface.high != 510, "Incorrect loaded surface speed");
+	
+	bool thrown = false;
+	try
+	{
+		table.Load(filename);
+	}
+	catch(const error&)
+	{
+		thrown = true;
+	}
+	die_if(!thrown, "Missing file not rejected");
+}
+
+int main()
+{
+	test_parse();
+	test_load();
+	return 0;
+}
@@ -0,0 +1,199 @@
+#include "Motion.h"
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include "die_if.h"
+
+using namespace cxxcam;
+using namespace cxxcam::motion;
+
+namespace
+{
+
+const double inf = std::numeric_limits<double>::infinity();
+
+bool close(double a, double b, double tolerance = 1e-9)
+{
+	return std::abs(a - b) <= tolerance * std::max(1.0, std::abs(b));
+}
+
+}
+
+void test_profile()
+{
+	// 100mm at 10mm/s, 100mm/s^2
+	die_if(!close(profile_time(0.1, 0.01, inf, inf), 10), "Incorrect constant velocity time");
+	die_if(!close(profile_time(0.1, 0.01, 0.1, inf), 10.1), "Incorrect trapezoidal time");
+	die_if(!close(profile_time(0.0001, 0.01, 0.1, inf), 2 * std::sqrt(0.001)), "Incorrect triangular time");
+	die_if(!close(profile_time(0.1, 0.01, 0.1, 1), 10.2), "Incorrect S-curve time");
+	die_if(!close(profile_time(0.1, 0.01, 0.1, 1e9), 10.1, 1e-6), "S-curve does not approach trapezoid");
+	die_if(profile_time(0, 0.01, 0.1, 1) != 0, "Incorrect zero distance time");
+	
+	// Increasing in distance, and continuous where the profile changes shape:
+	// where the acceleration limit is first reached and where the cruise
+	// velocity is first reached.
+	auto last = 0.0;
+	for(int i = 1; i <= 20000; ++i)
+	{
+		auto t = profile_time(i * 1e-6, 0.01, 0.1, 5);
+		die_if(t <= last, "Profile time not increasing with distance");
+		last = t;
+	}
+	auto v = 0.1 * 0.1 / 5;
+	for(auto d : {2 * v * std::sqrt(v / 5), 0.01 * (0.01 / 0.1 + 0.1 / 5)})
+		die_if(!close(profile_time(d * (1 - 1e-9), 0.01, 0.1, 5), profile_time(d * (1 + 1e-9), 0.01, 0.1, 5), 1e-6), "Profile time discontinuous");
+	
+	// Tighter limits never reduce the time.
+	die_if(profile_time(0.01, 0.05, 0.1, 2) < profile_time(0.01, 0.05, 0.2, 2), "Lower acceleration reduced time");
+	die_if(profile_time(0.01, 0.05, 0.1, 2) < profile_time(0.01, 0.05, 0.1, 4), "Lower jerk reduced time");
+}
+
+void test_moves()
+{
+	auto mm = [](double v) { return units::length{v * units::millimeters}; };
+	
+	limits::Rapids rapids;
+	rapids.SetGlobal(units::velocity{600 * units::millimeters_per_minute});
+	rapids.Set(Axis::Type::A, units::angular_velocity{50 * units::degrees_per_second});
+	
+	Position begin;
+	Position end;
+	end.X = mm(100);
+	end.Y = mm(-20);
+	end.A = units::plane_angle{90 * units::degrees};
+	
+	limits::Acceleration unlimited;
+	die_if(rapid_time(begin, end, rapids, unlimited) != rapids.Duration(begin, end), "Unlimited acceleration differs from rapid duration");
+	
+	limits::Acceleration acceleration;
+	acceleration.Set(Axis::Type::X, units::acceleration{100 * units::millimeters_per_second_squared});
+	acceleration.Set(Axis::Type::Y, units::acceleration{100 * units::millimeters_per_second_squared});
+	// X: 100mm at 10mm/s, 100mm/s^2
+	die_if(!close(rapid_time(begin, end, rapids, acceleration).value(), 10.1), "Incorrect rapid time");
+	
+	// 3-4-5 move in XY; the path accelerates until X reaches its limit.
+	limits::FeedRate feed;
+	Position p1;
+	p1.X = mm(30);
+	p1.Y = mm(40);
+	limits::Acceleration x_only;
+	x_only.Set(Axis::Type::X, units::acceleration{60 * units::millimeters_per_second_squared});
+	auto rate = units::velocity{600 * units::millimeters_per_minute};
+	die_if(!close(linear_time(begin, p1, rate, feed, x_only).value(), 5 + 0.1), "Incorrect linear time");
+	
+	// Per axis feed limits reduce the path rate.
+	feed.Set(Axis::Type::Y, units::velocity{240 * units::millimeters_per_minute});
+	die_if(!close(linear_time(begin, p1, rate, feed, unlimited).value(), 10), "Feed limit not applied");
+	
+	// Full circle of radius 10mm at 6000mm/min limited by centripetal acceleration.
+	Position start;
+	start.X = mm(10);
+	path::arc_plan circle(start, start, {}, path::ArcDirection::CounterClockwise, {0, 0, 1}, 1);
+	limits::FeedRate unlimited_feed;
+	auto fast = units::velocity{6000 * units::millimeters_per_minute};
+	auto t = arc_time(circle, fast, unlimited_feed, unlimited).value();
+	die_if(!close(t, circle.length().value() / 0.1), "Incorrect unconstrained arc time");
+	
+	t = arc_time(circle, fast, unlimited_feed, acceleration).value();
+	auto v = std::sqrt(0.1 * 0.01);
+	die_if(!close(t, circle.length().value() / v + v / 0.1), "Incorrect centripetal limited arc time");
+	
+	path::move_t move;
+	move.type = path::move_t::Type::Arc;
+	move.start = start;
+	move.end = start;
+	move.dir = path::ArcDirection::CounterClockwise;
+	die_if(move_time(move, fast, unlimited_feed, acceleration).value() != t, "Incorrect arc move time");
+}
+
+void test_plan()
+{
+	auto mm = [](double v) { return units::length{v * units::millimeters}; };
+	
+	limits::FeedRate feed;
+	limits::Acceleration acceleration;
+	for(auto axis : {Axis::Type::X, Axis::Type::Y, Axis::Type::Z})
+		acceleration.Set(axis, units::acceleration{100 * units::millimeters_per_second_squared});
+	auto rate = units::velocity{600 * units::millimeters_per_minute};
+	
+	auto line = [&](const Position& start, double x, double y)
+	{
+		path::move_t move;
+		move.start = start;
+		move.end = start;
+		move.end.X += mm(x);
+		move.end.Y += mm(y);
+		return move;
+	};
+	
+	// Collinear moves blend into one: 100mm at 10mm/s, 100mm/s^2
+	std::vector<path::move_t> moves;
+	Position p;
+	for(int i = 0; i < 100; ++i)
+	{
+		moves.push_back(line(p, 1, 0));
+		p = moves.back().end;
+	}
+	auto straight = plan(moves, rate, feed, acceleration, mm(0.01));
+	die_if(!close(straight.duration.value(), 10.1), "Collinear moves not blended");
+	die_if(straight.entry.size() != moves.size() || straight.durations.size() != moves.size(), "Incorrect plan size");
+	die_if(!close(plan(moves, rate, feed, acceleration, mm(0.01), 4).duration.value(), 10.1), "Short look-ahead not blended");
+	
+	auto stops = 0.0;
+	for(auto& move : moves)
+		stops += move_time(move, rate, feed, acceleration).value();
+	
+	// Reversals and a zero tolerance stop at every junction.
+	std::vector<path::move_t> zigzag;
+	std::vector<path::move_t> corners;
+	p = {};
+	Position q;
+	for(int i = 0; i < 100; ++i)
+	{
+		zigzag.push_back(line(p, i % 2 ? -1 : 1, 0));
+		p = zigzag.back().end;
+		corners.push_back(line(q, i % 2 ? 0 : 1, i % 2 ? 1 : 0));
+		q = corners.back().end;
+	}
+	die_if(!close(plan(zigzag, rate, feed, acceleration, mm(0.01)).duration.value(), stops), "Reversals not stopped");
+	die_if(!close(plan(corners, rate, feed, acceleration, mm(0)).duration.value(), stops), "Exact stop not applied");
+	
+	// Blended corners are faster than stopping but slower than straight motion,
+	// and a shorter look-ahead is never faster.
+	auto blended = plan(corners, rate, feed, acceleration, mm(0.01)).duration.value();
+	die_if(!(blended < stops && blended > straight.duration.value()), "Incorrect blended corner time");
+	
+	std::vector<path::move_t> accelerating;
+	p = {};
+	for(int i = 0; i < 1000; ++i)
+	{
+		accelerating.push_back(line(p, 0.01, 0));
+		p = accelerating.back().end;
+	}
+	auto full = plan(accelerating, rate, feed, acceleration, mm(0.01), 2000).duration.value();
+	auto windowed = plan(accelerating, rate, feed, acceleration, mm(0.01), 16).duration.value();
+	die_if(windowed < full - 1e-12, "Short look-ahead faster than full");
+	die_if(!close(full, move_time(line({}, 10, 0), rate, feed, acceleration).value()), "Incorrect full look-ahead time");
+	
+	// Tangent arc and line junctions are not slowed.
+	path::move_t arc;
+	arc.type = path::move_t::Type::Arc;
+	arc.start = line({}, 10, 0).end;
+	arc.end = arc.start;
+	arc.end.X = mm(15);
+	arc.end.Y = mm(5);
+	arc.center.X = mm(10);
+	arc.center.Y = mm(5);
+	arc.dir = path::ArcDirection::CounterClockwise;
+	std::vector<path::move_t> tangent{line({}, 10, 0), arc, line(arc.end, 0, 10)};
+	auto arc_plan = plan(tangent, rate, feed, acceleration, mm(0));
+	die_if(arc_plan.entry[1].value() <= 0 || arc_plan.entry[2].value() <= 0, "Tangent junction stopped");
+}
+
+int main()
+{
+	test_profile();
+	test_moves();
+	test_plan();
+	return 0;
+}
@@ -1,6 +1,8 @@
 #include "Path.h"
 #include <iostream>
 #include "die_if.h"
+#include <cmath>
+#include <algorithm>
 
 void simple()
 {
@@ -194,6 +196,549 @@ void reverse()
 	}
 }
 
+void streaming()
+{
+	std::cout << "streaming\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	Position start;
+	start.X = length{10 * millimeters};
+	
+	Position end;
+	end.Y = length{10 * millimeters};
+	end.Z = length{-5 * millimeters};
+	
+	limits::AvailableAxes geometry;
+	
+	auto range = arc_steps(start, end, {}, ArcDirection::CounterClockwise, {0, 0, 1}, 2, geometry, 10);
+	auto steps = expand_arc(start, end, {}, ArcDirection::CounterClockwise, {0, 0, 1}, 2, geometry, 10).path;
+	
+	die_if(range.size() != steps.size(), "Range size differs from expanded path");
+	
+	size_t i = 0;
+	for(const auto& step : range)
+		die_if(step != steps[i++], "Range step differs from expanded path");
+	die_if(i != steps.size(), "Range iterated incorrect number of steps");
+	
+	// Consumers may stop at any point without the remainder being generated.
+	auto it = range.begin();
+	for(size_t s = 0; s < 10; ++s)
+		++it;
+	die_if(*it != steps[10], "Incorrect step after partial iteration");
+}
+
+void long_arc()
+{
+	std::cout << "long_arc\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	limits::AvailableAxes geometry;
+	
+	// 50 turns of a 10mm radius helix; steps between the direct evaluation
+	// every anchor_interval (64) steps are rotated incrementally.
+	auto r = 10.0;
+	auto turns = 50;
+	Position start;
+	start.X = length{r * millimeters};
+	Position end = start;
+	end.Z = length{-5 * millimeters};
+	
+	auto range = arc_steps(start, end, {}, ArcDirection::CounterClockwise, {0, 0, 1}, turns, geometry, 10);
+	auto n = range.size();
+	die_if(n < 64 * 100, "Too few steps to cross anchors");
+	
+	double max_error = 0;
+	std::size_t k = 0;
+	for(const auto& step : range)
+	{
+		auto theta = 2 * 3.14159265358979323846 * turns * k / (n - 1);
+		auto dx = length_mm(step.position.x).value() - r * std::cos(theta);
+		auto dy = length_mm(step.position.y).value() - r * std::sin(theta);
+		max_error = std::max(max_error, std::hypot(dx, dy));
+		++k;
+	}
+	die_if(k != n, "Range iterated incorrect number of steps");
+	die_if(max_error > 1e-10, "Arc steps deviate from direct evaluation");
+}
+
+void soa()
+{
+	std::cout << "soa\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	Position start;
+	start.X = length{3 * millimeters};
+	start.Z = length{90 * millimeters};
+	
+	Position end;
+	end.X = length{-50 * millimeters};
+	end.Y = length{12.5 * millimeters};
+	end.Z = length{80 * millimeters};
+	
+	Position end_rotary = end;
+	end_rotary.A = plane_angle{45 * degrees};
+	end_rotary.C = plane_angle{-30 * degrees};
+	
+	limits::AvailableAxes geometry;
+	limits::AvailableAxes xz({Axis::Type::X, Axis::Type::Z});
+	
+	auto check = [](const step_range& range)
+	{
+		auto steps = expand(range).path;
+		auto soa = expand_soa(range);
+		
+		die_if(soa.size() != steps.size(), "SoA size differs from expanded path");
+		for(size_t i = 0; i < steps.size(); ++i)
+			die_if(soa[i] != steps[i], "SoA step differs from expanded path");
+	};
+	
+	check(linear_steps(start, end, geometry, 10));
+	check(linear_steps(start, end_rotary, geometry, 10));
+	check(linear_steps(start, end_rotary, xz, 10));
+	check(rotary_steps(start, end_rotary, geometry, 10));
+}
+
+void arc_planes()
+{
+	std::cout << "arc_planes\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	using namespace cxxcam::math;
+	
+	limits::AvailableAxes geometry;
+	
+	Position_Cartesian center;
+	center.X = length{5 * millimeters};
+	center.Y = length{-7 * millimeters};
+	center.Z = length{3 * millimeters};
+	
+	auto r = 10.0;
+	auto tolerance = 1e-9;
+	
+	// XY
+	{
+		Position start;
+		start.X = center.X + length{r * millimeters};
+		start.Y = center.Y;
+		Position end = start;
+		end.Z = length{-20 * millimeters};
+		
+		for(const auto& step : arc_steps(start, end, center, ArcDirection::Clockwise, {0, 0, 1}, 20, geometry, 10))
+		{
+			auto d = length_mm(distance({step.position.x, step.position.y, 0}, {center.X, center.Y, 0})).value();
+			die_if(std::abs(d - r) > tolerance, "XY arc step off radius");
+		}
+	}
+	// XZ
+	{
+		Position start;
+		start.X = center.X;
+		start.Z = center.Z + length{r * millimeters};
+		Position end = start;
+		end.Y = length{15 * millimeters};
+		
+		for(const auto& step : arc_steps(start, end, center, ArcDirection::CounterClockwise, {0, 1, 0}, 20, geometry, 10))
+		{
+			auto d = length_mm(distance({step.position.x, 0, step.position.z}, {center.X, 0, center.Z})).value();
+			die_if(std::abs(d - r) > tolerance, "XZ arc step off radius");
+		}
+	}
+	// YZ
+	{
+		Position start;
+		start.Y = center.Y + length{r * millimeters};
+		start.Z = center.Z;
+		Position end = start;
+		end.X = length{-15 * millimeters};
+		
+		for(const auto& step : arc_steps(start, end, center, ArcDirection::Clockwise, {1, 0, 0}, 20, geometry, 10))
+		{
+			auto d = length_mm(distance({0, step.position.y, step.position.z}, {0, center.Y, center.Z})).value();
+			die_if(std::abs(d - r) > tolerance, "YZ arc step off radius");
+		}
+	}
+}
+
+void tolerance()
+{
+	std::cout << "tolerance\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	using namespace cxxcam::math;
+	
+	limits::AvailableAxes geometry;
+	deviation_t tolerance{ length{0.01 * millimeters}, plane_angle{1 * degrees} };
+	
+	// Straight moves need only their end points.
+	{
+		Position start;
+		Position end;
+		end.X = length{500 * millimeters};
+		
+		auto path = expand_linear(start, end, geometry, tolerance);
+		die_if(path.path.size() != 2, "Straight move oversampled");
+		die_if(path.deviation.chordal != length{}, "Straight move reports chordal deviation");
+	}
+	
+	// Small arcs are sampled to within the chordal tolerance.
+	{
+		Position start;
+		start.X = length{0.5 * millimeters};
+		Position end = start;
+		
+		auto path = expand_arc(start, end, {}, ArcDirection::CounterClockwise, {0, 0, 1}, 1, geometry, tolerance);
+		std::cout << path.path.size() << " steps, deviation " << length_mm(path.deviation.chordal) << '\n';
+		die_if(path.deviation.chordal > tolerance.chordal, "Arc deviation exceeds tolerance");
+		
+		auto dtheta = 2 * 3.14159265358979323846 / (path.path.size() - 1);
+		auto sagitta = 0.5 * (1 - std::cos(dtheta / 2));
+		die_if(sagitta > 0.01, "Arc step spacing exceeds tolerance");
+	}
+	
+	// Rotary motion is bounded by the angular tolerance.
+	{
+		Position start;
+		Position end;
+		end.X = length{100 * millimeters};
+		end.A = plane_angle{45 * degrees};
+		
+		auto path = expand_linear(start, end, geometry, tolerance);
+		die_if(path.path.size() != 46, "Rotary motion incorrectly sampled");
+		die_if(path.deviation.angular > tolerance.angular, "Angular deviation exceeds tolerance");
+	}
+}
+
+void orientation()
+{
+	std::cout << "orientation\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	using namespace cxxcam::math;
+	
+	Position start;
+	start.A = plane_angle{10 * degrees};
+	
+	Position end;
+	end.X = length{200 * millimeters};
+	end.A = plane_angle{100 * degrees};
+	end.C = plane_angle{-45 * degrees};
+	
+	limits::AvailableAxes geometry;
+	
+	auto steps = expand_linear(start, end, geometry, 1).path;
+	die_if(steps.size() != 201, "Incorrect step count");
+	
+	// Orientations are stepped incrementally; they must match direct evaluation.
+	for(size_t s = 0; s < steps.size(); ++s)
+	{
+		auto scale = s / 200.0;
+		auto a = start.A + (end.A - start.A) * scale;
+		auto c = start.C + (end.C - start.C) * scale;
+		auto q = normalise(normalise(axis2quat(1, 0, 0, a)) * normalise(axis2quat(0, 0, 1, c)));
+		
+		auto& o = steps[s].orientation;
+		auto error = std::abs(o.R_component_1() - q.R_component_1()) + std::abs(o.R_component_2() - q.R_component_2()) + 
+			std::abs(o.R_component_3() - q.R_component_3()) + std::abs(o.R_component_4() - q.R_component_4());
+		die_if(error > 1e-12, "Orientation deviates from direct evaluation");
+	}
+}
+
+void axis_sets()
+{
+	std::cout << "axis_sets\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	Position start;
+	start.Y = length{-4 * millimeters};
+	
+	Position end;
+	end.X = length{20 * millimeters};
+	end.Y = length{6 * millimeters};
+	end.Z = length{-3 * millimeters};
+	end.A = plane_angle{30 * degrees};
+	
+	// Common machine axis sets are expanded by specialised generators.
+	auto check = [&](const limits::AvailableAxes& specialised, const limits::AvailableAxes& generic)
+	{
+		auto s = expand_linear(start, end, specialised, 10).path;
+		auto g = expand_linear(start, end, generic, 10).path;
+		die_if(s != g, "Specialised linear expansion differs");
+		
+		s = expand_arc(start, start, {}, ArcDirection::Clockwise, {0, 0, 1}, 1, specialised, 10).path;
+		g = expand_arc(start, start, {}, ArcDirection::Clockwise, {0, 0, 1}, 1, generic, 10).path;
+		die_if(s != g, "Specialised arc expansion differs");
+	};
+	
+	check(limits::AvailableAxes({Axis::Type::X, Axis::Type::Y, Axis::Type::Z}), limits::AvailableAxes({Axis::Type::Z, Axis::Type::Y, Axis::Type::X, Axis::Type::B}));
+	check(limits::AvailableAxes({Axis::Type::X, Axis::Type::Y, Axis::Type::Z, Axis::Type::A}), limits::AvailableAxes({Axis::Type::A, Axis::Type::X, Axis::Type::Y, Axis::Type::Z}));
+}
+
+void program()
+{
+	std::cout << "program\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	limits::AvailableAxes geometry;
+	
+	std::vector<move_t> moves;
+	Position p;
+	for(int i = 0; i < 2000; ++i)
+	{
+		move_t move;
+		move.start = p;
+		switch(i % 3)
+		{
+			case 0:
+				move.type = move_t::Type::Linear;
+				p.X += length{(i % 7) * millimeters};
+				p.Z -= length{0.1 * millimeters};
+				break;
+			case 1:
+				move.type = move_t::Type::Rotary;
+				p.A += plane_angle{(i % 5) * degrees};
+				break;
+			case 2:
+				move.type = move_t::Type::Arc;
+				move.center = p;
+				move.center.X += length{2 * millimeters};
+				move.dir = ArcDirection::CounterClockwise;
+				break;
+		}
+		move.end = p;
+		moves.push_back(move);
+	}
+	
+	auto serial = expand_program(moves, geometry, 10, 1);
+	auto parallel = expand_program(moves, geometry, 10, 4);
+	
+	die_if(serial.path != parallel.path, "Parallel expansion differs from serial");
+	die_if(serial.offsets != parallel.offsets, "Parallel offsets differ from serial");
+	
+	for(size_t i = 0; i < moves.size(); i += 97)
+	{
+		auto steps = expand(move_steps(moves[i], geometry, 10)).path;
+		die_if(!std::equal(steps.begin(), steps.end(), parallel.path.begin() + parallel.offsets[i]), "Move steps not at offset");
+	}
+}
+
+void reuse()
+{
+	std::cout << "reuse\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	limits::AvailableAxes geometry({Axis::Type::X, Axis::Type::Y, Axis::Type::Z, Axis::Type::A});
+	
+	Position start;
+	Position end;
+	end.X = length{20 * millimeters};
+	end.A = plane_angle{45 * degrees};
+	
+	// Expanding a shorter move into a used path keeps its capacity.
+	path_t path;
+	expand_into(path, linear_steps(start, end, geometry, 10));
+	die_if(path.path != expand_linear(start, end, geometry, 10).path, "expand_into differs from expand");
+	auto capacity = path.path.capacity();
+	auto data = path.path.data();
+	
+	expand_into(path, arc_steps(start, start, {}, ArcDirection::Clockwise, {0, 0, 1}, 1, geometry, 1));
+	die_if(path.path != expand_arc(start, start, {}, ArcDirection::Clockwise, {0, 0, 1}, 1, geometry, 1).path, "expand_into did not replace path");
+	die_if(path.path.capacity() != capacity || path.path.data() != data, "expand_into reallocated");
+	
+	// Generators and steps allocated from an arena.
+	arena storage(4096);
+	for(int pass = 0; pass < 3; ++pass)
+	{
+		storage.reset();
+		
+		std::vector<step, arena_allocator<step>> steps{arena_allocator<step>(storage)};
+		expand_into(steps, linear_steps(start, end, geometry, 10, storage));
+		die_if(!std::equal(steps.begin(), steps.end(), expand_linear(start, end, geometry, 10).path.begin()), "Arena expansion differs");
+		
+		deviation_t tolerance{length{0.01 * millimeters}, plane_angle{1 * degrees}};
+		move_t move;
+		move.type = move_t::Type::Arc;
+		move.end = start;
+		move.center.X = length{5 * millimeters};
+		expand_into(steps, move_steps(move, geometry, tolerance, storage));
+		die_if(steps.size() != move_steps(move, geometry, tolerance).size(), "Arena tolerance expansion differs");
+		
+		if(pass == 0)
+			capacity = storage.capacity();
+		die_if(storage.capacity() != capacity, "Arena grew after reset");
+	}
+}
+
+void plan()
+{
+	std::cout << "plan\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	limits::AvailableAxes geometry;
+	
+	Position_Cartesian center;
+	center.X = length{5 * millimeters};
+	center.Y = length{-7 * millimeters};
+	center.Z = length{3 * millimeters};
+	auto r = 10.0;
+	
+	auto on_circle = [&](const math::vector_3& plane, double theta, double helix) -> Position
+	{
+		Position p;
+		auto u = length{r * std::cos(theta) * millimeters};
+		auto v = length{r * std::sin(theta) * millimeters};
+		if(plane.z)
+		{
+			p.X = center.X + u;
+			p.Y = center.Y + v;
+			p.Z = length{helix * millimeters};
+		}
+		else if(plane.y)
+		{
+			p.X = center.X + u;
+			p.Z = center.Z + v;
+			p.Y = length{helix * millimeters};
+		}
+		else
+		{
+			p.Z = center.Z + u;
+			p.Y = center.Y + v;
+			p.X = length{helix * millimeters};
+		}
+		return p;
+	};
+	
+	const math::vector_3 planes[] = {{0, 0, 1}, {0, 1, 0}, {1, 0, 0}};
+	const double spans[][2] = {{0.3, 1.2}, {-2.5, 2.9}, {1.0, 1.0}, {3.0, -3.0}};
+	for(auto& plane : planes)
+	{
+		for(auto& span : spans)
+		{
+			for(auto dir : {ArcDirection::Clockwise, ArcDirection::CounterClockwise})
+			{
+				auto start = on_circle(plane, span[0], 1);
+				auto end = on_circle(plane, span[1], -4);
+				
+				arc_plan arc(start, end, center, dir, plane, 1);
+				die_if(arc.length() != length_arc(start, end, center, dir, plane, 1), "Plan length differs from length_arc");
+				
+				auto steps = expand(arc.steps(geometry, 100)).path;
+				die_if(steps != expand_arc(start, end, center, dir, plane, 1, geometry, 100).path, "Plan steps differ from expand_arc");
+				
+				std::vector<math::point_3> points;
+				for(auto& step : steps)
+					points.push_back(step.position);
+				auto sampled = construct(points);
+				auto box = arc.bounding_box();
+				
+				auto close = [](const math::point_3& a, const math::point_3& b)
+				{
+					auto eps = 1e-8;
+					return std::abs((a.x - b.x).value()) < eps && std::abs((a.y - b.y).value()) < eps && std::abs((a.z - b.z).value()) < eps;
+				};
+				die_if(!close(box.min, sampled.min) || !close(box.max, sampled.max), "Plan bounding box differs from expanded extent");
+			}
+		}
+	}
+	
+	die_if(std::abs(arc_plan(on_circle(planes[0], 0, 0), on_circle(planes[0], 0, 0), center, ArcDirection::Clockwise, planes[0], 3).angular_span().value() - 6 * 3.14159265358979323846) > 1e-12, "Incorrect angular span");
+}
+
+void bounds()
+{
+	std::cout << "bounds\n";
+	using namespace cxxcam;
+	using namespace cxxcam::path;
+	using namespace cxxcam::units;
+	
+	auto mm = [](double v) { return length{v * millimeters}; };
+	
+	Position start;
+	start.X = mm(10);
+	Position end;
+	end.Y = mm(10);
+	end.Z = mm(-2);
+	
+	auto ccw = bbox_arc(start, end, {}, ArcDirection::CounterClockwise, {0, 0, 1}, 1);
+	die_if(ccw != Bbox{{mm(0), mm(0), mm(-2)}, {mm(10), mm(10), mm(0)}}, "Incorrect quarter arc extent");
+	
+	auto cw = bbox_arc(start, end, {}, ArcDirection::Clockwise, {0, 0, 1}, 1);
+	die_if(cw != Bbox{{mm(-10), mm(-10), mm(-2)}, {mm(10), mm(10), mm(0)}}, "Incorrect three quarter arc extent");
+	
+	auto line = bbox_linear(end, start);
+	die_if(line != Bbox{{mm(0), mm(0), mm(-2)}, {mm(10), mm(10), mm(0)}}, "Incorrect linear extent");
+	
+	// Every expanded step lies within the extent of its move.
+	limits::AvailableAxes geometry;
+	std::vector<move_t> moves;
+	Position p;
+	for(int i = 0; i < 60; ++i)
+	{
+		move_t move;
+		move.start = p;
+		switch(i % 3)
+		{
+			case 0:
+				move.type = move_t::Type::Linear;
+				p.X += mm((i % 7) - 3);
+				p.Z -= mm(0.5);
+				break;
+			case 1:
+				move.type = move_t::Type::Rotary;
+				p.A += plane_angle{(i % 5) * degrees};
+				break;
+			case 2:
+			{
+				static const math::vector_3 planes[] = {{0, 0, 1}, {0, 1, 0}, {1, 0, 0}};
+				move.type = move_t::Type::Arc;
+				move.plane = planes[(i / 3) % 3];
+				move.center = p;
+				if(move.plane.x)
+					move.center.Z += mm(3);
+				else
+					move.center.X += mm(3);
+				move.dir = (i / 9) % 2 ? ArcDirection::Clockwise : ArcDirection::CounterClockwise;
+				break;
+			}
+		}
+		move.end = p;
+		moves.push_back(move);
+	}
+	
+	for(auto& move : moves)
+	{
+		auto box = bbox_move(move);
+		std::vector<math::point_3> points;
+		for(auto& step : move_steps(move, geometry, 100))
+			points.push_back(step.position);
+		auto sampled = construct(points);
+		
+		auto eps = 1e-8;
+		auto within = [&](const math::point_3& lo, const math::point_3& hi)
+		{
+			return (lo.x - hi.x).value() < eps && (lo.y - hi.y).value() < eps && (lo.z - hi.z).value() < eps;
+		};
+		die_if(!within(box.min, sampled.min) || !within(sampled.max, box.max), "Step outside move extent");
+		die_if(!within(sampled.min, box.min) || !within(box.max, sampled.max), "Move extent not tight");
+	}
+}
+
 int main()
 {
 	simple();
@@ -202,6 +747,17 @@ int main()
 	nintyonedegrees();
 	z8();
 	reverse();
+	streaming();
+	long_arc();
+	soa();
+	arc_planes();
+	tolerance();
+	orientation();
+	axis_sets();
+	program();
+	reuse();
+	plan();
+	bounds();
 	
 	return 0;
 }
@@ -2,11 +2,122 @@
 #include "Error.h"
 #include <iostream>
 #include "Units.h"
+#include "die_if.h"
+#include <vector>
+#include <cmath>
 
 using namespace cxxcam;
 
+/*
+ * Compares the spindle_table lookups against the Spindle.
+ */
+void test_table()
+{
+	Spindle s(2000);
+	s.AddRange(0, 300);
+	s.AddRange(500, 1000);
+	s.AddRange(3000, 7000);
+	s.AddDiscrete(10000);
+	s.AddDiscrete(1500);
+	s.SetTorque(100, 1 * units::newton_meters);
+	s.SetTorque(1000, 10 * units::newton_meters);
+	s.SetTorque(7000, 4 * units::newton_meters);
+	
+	spindle_table table(s);
+	
+	std::vector<unsigned long> requested;
+	for(unsigned long rpm = 0; rpm <= 13000; rpm += 7)
+		requested.push_back(rpm);
+	// Halfway between 300 and 500, 1000 and 1500.
+	requested.push_back(400);
+	requested.push_back(1250);
+	
+	std::vector<unsigned long> speeds(requested.size());
+	auto failed = table.Normalise(requested.data(), requested.size(), speeds.data());
+	std::size_t thrown = 0;
+	for(std::size_t i = 0; i < requested.size(); ++i)
+	{
+		unsigned long expected;
+		try
+		{
+			expected = s.Normalise(requested[i]);
+		}
+		catch(const error&)
+		{
+			++thrown;
+			expected = spindle_table::unattainable;
+		}
+		die_if(speeds[i] != expected, "Batch speed differs from Spindle");
+		if(expected != spindle_table::unattainable)
+			die_if(table.Normalise(requested[i]) != expected, "Speed differs from Spindle");
+	}
+	die_if(failed != thrown || failed == 0, "Incorrect unattainable count");
+	die_if(table.Normalise(400) != 300 || table.Normalise(1250) != 1000, "Tie not resolved to the lower speed");
+	
+	std::vector<unsigned long> rpm;
+	for(unsigned long r = 100; r <= 7000; r += 13)
+		rpm.push_back(r);
+	rpm.push_back(7000);
+	std::vector<units::torque> torque(rpm.size());
+	table.GetTorque(rpm.data(), rpm.size(), torque.data());
+	for(std::size_t i = 0; i < rpm.size(); ++i)
+	{
+		auto expected = s.GetTorque(rpm[i]).value();
+		die_if(std::abs(torque[i].value() - expected) > 1e-12 * std::abs(expected), "Torque differs from Spindle");
+	}
+	die_if(table.GetTorque(50).value() != 1 || table.GetTorque(9000).value() != 4, "Torque outside samples not clamped");
+}
+
+void test_power()
+{
+	auto kw = [](double v) { return units::power{v * units::kilowatts}; };
+	auto nm = [](double v) { return units::torque{v * units::newton_meters}; };
+	
+	{
+		Spindle s;
+		s.SetPower(1000, kw(1));
+		s.SetPower(3000, kw(3));
+		spindle_table table(s);
+		for(unsigned long rpm : {500ul, 1000ul, 2000ul, 2500ul, 5000ul})
+		{
+			auto expected = units::power_kw(s.GetPower(rpm)).value();
+			die_if(std::abs(expected - std::min(std::max(rpm, 1000ul), 3000ul) / 1000.0) > 1e-12, "Incorrect interpolated power");
+			die_if(std::abs(units::power_kw(table.GetPower(rpm)).value() - expected) > 1e-12, "Table power differs from Spindle");
+		}
+	}
+	
+	Spindle s;
+	s.AddRange(0, 24000);
+	s.SetTorque(0, nm(10));
+	s.SetTorque(24000, nm(10));
+	s.SetPower(24000, kw(3));
+	spindle_table table(s);
+	
+	// 3kW is 10Nm at ~2865rpm; below that the torque curve limits.
+	die_if(table.AvailableTorque(1000) != nm(10), "Torque limit not applied");
+	die_if(std::abs(table.AvailableTorque(12000).value() - 3000 / (12000 * 2 * 3.14159265358979323846 / 60)) > 1e-12, "Power limit not applied");
+	
+	std::vector<spindle_load> loads{
+		{1000, nm(5), {}},
+		{1000, {}, kw(2)},
+		{12000, nm(2), {}},
+		{12000, nm(1), kw(3.5)},
+		{30000, nm(1), kw(6)},
+		{24000, {}, kw(3)},
+	};
+	auto overloads = table.Overloads(loads);
+	die_if(overloads.size() != 3, "Incorrect overload count");
+	die_if(overloads[0].move != 1 || overloads[0].rpm != 1000 || overloads[0].available != nm(10), "Incorrect torque overload");
+	die_if(overloads[1].move != 3 || overloads[1].required <= overloads[1].available, "Incorrect power overload");
+	die_if(overloads[2].move != 4 || overloads[2].rpm != spindle_table::unattainable, "Unattainable speed not reported");
+	die_if(std::abs(overloads[2].required.value() - 6000 / (30000 * 2 * 3.14159265358979323846 / 60)) > 1e-12, "Incorrect unattainable required torque");
+}
+
 int main()
 {
+	test_table();
+	test_power();
+	
 	{
 		Spindle s;
 		s.AddRange(1, 100);
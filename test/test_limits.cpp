@@ -1,7 +1,10 @@
 #include "Limits.h"
 #include "Position.h"
+#include "Path.h"
 #include <iostream>
 #include <stdexcept>
+#include <cmath>
+#include "Error.h"
 #include "die_if.h"
 
 using namespace cxxcam;
@@ -42,9 +45,123 @@ void test_feedrate()
 	r.Validate(Axis::Type::A, units::angular_velocity{5 * units::degrees_per_second});
 }
 
+void test_batch()
+{
+	auto mm = [](double v) { return units::length{v * units::millimeters}; };
+	
+	Rapids r;
+	r.SetGlobal(units::velocity{500 * units::millimeters_per_minute});
+	r.Set(Axis::Type::Z, units::velocity{200 * units::millimeters_per_minute});
+	r.Set(Axis::Type::A, units::angular_velocity{50 * units::degrees_per_second});
+	
+	std::vector<Position> path(4);
+	path[1].X = mm(500);
+	path[2] = path[1];
+	path[2].Z = mm(-100);
+	path[3] = path[2];
+	path[3].A = units::plane_angle{100 * units::degrees};
+	
+	// 60s in X, 30s in Z, 2s in A.
+	auto total = r.Duration(path);
+	std::cout << "Batch rapid time: " << total << "\n";
+	die_if(std::abs(total.value() - 92) > 1e-9, "Incorrect batch rapid duration");
+	die_if(total != r.Duration(path[0], path[1]) + r.Duration(path[1], path[2]) + r.Duration(path[2], path[3]), "Batch rapid duration differs from moves");
+	
+	Rapids stalled;
+	bool thrown = false;
+	try
+	{
+		stalled.Duration(path);
+	}
+	catch(const error&)
+	{
+		thrown = true;
+	}
+	die_if(!thrown, "Movement on zero velocity axis not rejected");
+	
+	Travel t;
+	t.SetLimit(Axis::Type::X, mm(500));
+	t.Validate(path);
+	path[1].X = mm(501);
+	thrown = false;
+	try
+	{
+		t.Validate(path);
+	}
+	catch(const error&)
+	{
+		thrown = true;
+	}
+	die_if(!thrown, "Travel outside limit not rejected");
+	
+	FeedRate f;
+	f.SetGlobal(units::velocity{100 * units::millimeters_per_minute});
+	f.Set(Axis::Type::Z, units::velocity{50 * units::millimeters_per_minute});
+	
+	// 3-4-5 move in XZ; at 80mm/min X moves at 48mm/min and Z at 64mm/min.
+	std::vector<Position> feed(2);
+	feed[1].X = mm(3);
+	feed[1].Z = mm(4);
+	f.Validate(feed, units::velocity{60 * units::millimeters_per_minute});
+	thrown = false;
+	try
+	{
+		f.Validate(feed, units::velocity{80 * units::millimeters_per_minute});
+	}
+	catch(const error&)
+	{
+		thrown = true;
+	}
+	die_if(!thrown, "Axis feed rate outside limit not rejected");
+}
+
+void test_violations()
+{
+	auto mm = [](double v) { return units::length{v * units::millimeters}; };
+	
+	Travel t;
+	t.SetLimit(Axis::Type::X, mm(100));
+	t.SetLimit(Axis::Type::Z, mm(10));
+	
+	// Odd length so the vector and scalar tails are both exercised.
+	path::path_t path;
+	for(int i = 0; i < 37; ++i)
+	{
+		path::step s;
+		s.position.x = mm(i * 2);
+		s.position.y = mm(1000);
+		s.position.z = mm(5);
+		path.path.push_back(s);
+	}
+	path::path_soa soa;
+	for(auto& s : path.path)
+		soa.push_back(s);
+	
+	die_if(!t.Violations(path).empty(), "Path within envelope rejected");
+	die_if(!t.Violations(soa).empty(), "Path within envelope rejected");
+	
+	path.path[3].position.z = mm(11);
+	path.path[36].position.z = mm(12);
+	for(auto i : {3, 36})
+		soa.set(i, path.path[i]);
+	path.path[35].position.x = mm(150);
+	soa.set(35, path.path[35]);
+	
+	for(auto& violations : {t.Violations(path), t.Violations(soa)})
+	{
+		die_if(violations.size() != 3, "Incorrect violation count");
+		die_if(violations[0].step != 3 || violations[0].axis != Axis::Type::Z, "Incorrect violation");
+		die_if(violations[1].step != 35 || violations[1].axis != Axis::Type::X, "Incorrect violation");
+		die_if(violations[2].step != 36 || violations[2].axis != Axis::Type::Z, "Incorrect violation");
+		die_if(std::abs(violations[1].travel.value() - 0.15) > 1e-12, "Incorrect violation travel");
+	}
+}
+
 int main()
 {
 	test_rapids();
 	test_feedrate();
+	test_batch();
+	test_violations();
 	return 0;
 }